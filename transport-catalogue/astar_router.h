@@ -0,0 +1,154 @@
+#pragma once
+
+#include "csr_graph.h"
+#include "graph.h"
+#include "routing_engine.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// bidirectional A* engine: no preprocessing besides CSR copies, both searches are guided
+// by a caller supplied lower bound, so a query only explores the area between its ends
+template <typename Weight>
+class AStarRouter : public RoutingEngine<Weight> {
+
+public:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using RouteInfo = typename RoutingEngine<Weight>::RouteInfo;
+
+    /* lower bound of the route weight between two vertices, has to be symmetric and consistent:
+       lower_bound(u, x) <= weight(u -> v) + lower_bound(v, x) for every edge and vertex x */
+    using LowerBound = std::function<double(VertexId from, VertexId to)>;
+
+    AStarRouter(const Graph& graph, LowerBound lower_bound);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+private:
+    Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    CsrGraph<Weight> csr_graphs_[2];    // forward and reversed
+    LowerBound lower_bound_;
+};
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(const Graph& graph, LowerBound lower_bound)
+    : graph_(graph)
+    , csr_graphs_{CsrGraph<Weight>(graph), CsrGraph<Weight>(graph, true)}
+    , lower_bound_(std::move(lower_bound))
+{
+    for (const auto& edge : graph_.GetEdges()) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename AStarRouter<Weight>::RouteInfo> AStarRouter<Weight>::BuildRoute(VertexId from,
+                                                                                       VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        return std::nullopt;
+    }
+
+    struct Label {
+        Weight weight;
+        std::optional<EdgeId> edge;     // forward: edge into the vertex, backward: edge out of it
+        double potential;
+    };
+
+    // average potentials: forward one is (bound to 'to' - bound from 'from') / 2, backward one is its negation.
+    // Both searches then work on the same reduced costs and may stop once
+    // their smallest keys sum up to the best route found
+    auto forward_potential = [&](VertexId vertex) {
+        return (lower_bound_(vertex, to) - lower_bound_(from, vertex)) / 2;
+    };
+
+    using QueueItem = std::tuple<double, Weight, VertexId>;    // key, weight, vertex
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    // index 0 - forward search from 'from', index 1 - backward search from 'to'
+    std::unordered_map<VertexId, Label> labels[2];
+    Queue queues[2];
+
+    auto relax = [&](size_t side, VertexId vertex, Weight weight, std::optional<EdgeId> edge) {
+        auto it = labels[side].find(vertex);
+        if (it == labels[side].end()) {
+            const double potential = side == 0 ? forward_potential(vertex) : -forward_potential(vertex);
+            it = labels[side].emplace(vertex, Label{weight, edge, potential}).first;
+        } else if (weight < it->second.weight) {
+            it->second.weight = weight;
+            it->second.edge = edge;
+        } else {
+            return false;
+        }
+        queues[side].push({static_cast<double>(weight) + it->second.potential, weight, vertex});
+        return true;
+    };
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+
+    auto update_best = [&](VertexId vertex) {
+        auto forward = labels[0].find(vertex);
+        auto backward = labels[1].find(vertex);
+        if (forward == labels[0].end() || backward == labels[1].end()) {
+            return;
+        }
+        const Weight weight = forward->second.weight + backward->second.weight;
+        if (!best_weight || weight < *best_weight) {
+            best_weight = weight;
+            meeting_vertex = vertex;
+        }
+    };
+
+    relax(0, from, ZERO_WEIGHT, std::nullopt);
+    relax(1, to, ZERO_WEIGHT, std::nullopt);
+    update_best(from);
+
+    for (size_t side = 0; !queues[0].empty() && !queues[1].empty(); side ^= 1) {
+        if (best_weight
+            && !(std::get<0>(queues[0].top()) + std::get<0>(queues[1].top()) < static_cast<double>(*best_weight))) {
+            break;
+        }
+
+        auto& queue = queues[side];
+        const auto [key, weight, vertex] = queue.top();
+        queue.pop();
+        if (labels[side][vertex].weight < weight) {
+            continue;
+        }
+
+        for (const auto& edge : csr_graphs_[side].GetIncidentEdges(vertex)) {
+            if (relax(side, edge.to, weight + edge.weight, csr_graphs_[side].GetEdgeId(edge))) {
+                update_best(edge.to);
+            }
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (auto edge_id = labels[0][meeting_vertex].edge; edge_id; edge_id = labels[0][graph_.GetEdge(*edge_id).from].edge) {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    for (auto edge_id = labels[1][meeting_vertex].edge; edge_id; edge_id = labels[1][graph_.GetEdge(*edge_id).to].edge) {
+        edges.push_back(*edge_id);
+    }
+
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,452 @@
+#pragma once
+
+#include "graph.h"
+#include "routing_engine.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// contraction hierarchy engine: vertices are contracted in importance order at build time,
+// queries run a bidirectional search that only goes up the hierarchy
+template <typename Weight>
+class ContractionHierarchy : public RoutingEngine<Weight> {
+
+public:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using RouteInfo = typename RoutingEngine<Weight>::RouteInfo;
+
+    /* edge added during contraction, replaces path first_edge -> second_edge.
+       Edge ids below graph edge count are graph edges, the rest are shortcuts by index */
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first_edge;
+        EdgeId second_edge;
+    };
+
+    explicit ContractionHierarchy(const Graph& graph);
+
+    /* restores already contracted hierarchy, throws std::invalid_argument if it doesn't fit the graph */
+    ContractionHierarchy(const Graph& graph, std::vector<size_t>& ranks, std::vector<Shortcut>& shortcuts);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    const std::vector<size_t>& GetRanks() const{
+        return ranks_;
+    }
+
+    const std::vector<Shortcut>& GetShortcuts() const{
+        return shortcuts_;
+    }
+
+private:
+
+    struct Arc {
+        VertexId to;
+        Weight weight;
+        EdgeId edge_id;
+    };
+
+    using ArcList = std::vector<Arc>;
+
+    // settled vertices limit for witness searches, trades shortcut count for build time
+    static constexpr size_t witnessSettledLimit = 50;
+
+    void Contract();
+    void BuildUpwardGraph();
+
+    /* collects shortcuts needed to contract vertex into pending_shortcuts_, returns edge difference */
+    int SimulateContraction(VertexId vertex);
+    void ApplyContraction(VertexId vertex);
+
+    /* bounded search in the remaining graph that avoids 'skipped' vertex,
+       distances are left in witness_weights_ until ResetWitnessSearch */
+    void WitnessSearch(VertexId from, VertexId skipped, Weight limit, size_t targets_count);
+    void ResetWitnessSearch();
+
+    void AddOrUpdateArc(ArcList& arcs, const Arc& arc);
+
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+
+    Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    std::vector<size_t> ranks_;
+    std::vector<Shortcut> shortcuts_;
+
+    // contraction state, dropped after the hierarchy is built
+    std::vector<ArcList> out_arcs_;
+    std::vector<ArcList> in_arcs_;
+    std::vector<bool> contracted_;
+    std::vector<int> contracted_neighbours_;
+    std::vector<std::optional<Weight>> witness_weights_;
+    std::vector<VertexId> witness_touched_;
+    std::vector<bool> witness_targets_;
+    std::vector<Shortcut> pending_shortcuts_;
+
+    // query state: forward search goes by edges to higher ranks,
+    // backward search goes by reversed edges coming from higher ranks
+    std::vector<ArcList> upward_arcs_;
+    std::vector<ArcList> downward_arcs_;
+};
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+    : graph_(graph)
+{
+    Contract();
+    BuildUpwardGraph();
+}
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, std::vector<size_t>& ranks,
+                                                   std::vector<Shortcut>& shortcuts)
+    : graph_(graph)
+    , ranks_(std::move(ranks))
+    , shortcuts_(std::move(shortcuts))
+{
+    if (ranks_.size() != graph_.GetVertexCount()) {
+        throw std::invalid_argument("Contraction hierarchy doesn't match the graph");
+    }
+    for (size_t i = 0; i < shortcuts_.size(); ++i) {
+        // a shortcut replaces edges and shortcuts added before it, so unpacking it ends
+        const auto& shortcut = shortcuts_[i];
+        const EdgeId shortcut_id = graph_.GetEdgeCount() + i;
+        if (shortcut.from >= graph_.GetVertexCount() || shortcut.to >= graph_.GetVertexCount()
+            || shortcut.first_edge >= shortcut_id || shortcut.second_edge >= shortcut_id) {
+            throw std::invalid_argument("Contraction hierarchy doesn't match the graph");
+        }
+    }
+    BuildUpwardGraph();
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::AddOrUpdateArc(ArcList& arcs, const Arc& arc) {
+    for (auto& existing : arcs) {
+        if (existing.to == arc.to) {
+            if (arc.weight < existing.weight) {
+                existing = arc;
+            }
+            return;
+        }
+    }
+    arcs.push_back(arc);
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::WitnessSearch(VertexId from, VertexId skipped, Weight limit, size_t targets_count) {
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+    witness_weights_[from] = ZERO_WEIGHT;
+    witness_touched_.push_back(from);
+    queue.push({ZERO_WEIGHT, from});
+
+    size_t settled = 0;
+    while (!queue.empty() && settled < witnessSettledLimit && targets_count) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+
+        if (*witness_weights_[vertex] < weight) {
+            continue;
+        }
+        if (limit < weight) {
+            break;
+        }
+        ++settled;
+        if (witness_targets_[vertex]) {
+            --targets_count;
+        }
+
+        for (const Arc& arc : out_arcs_[vertex]) {
+            if (arc.to == skipped || contracted_[arc.to]) {
+                continue;
+            }
+            const Weight candidate_weight = weight + arc.weight;
+            auto& witness_weight = witness_weights_[arc.to];
+            if (!witness_weight || candidate_weight < *witness_weight) {
+                if (!witness_weight) {
+                    witness_touched_.push_back(arc.to);
+                }
+                witness_weight = candidate_weight;
+                queue.push({candidate_weight, arc.to});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::ResetWitnessSearch() {
+    for (const VertexId vertex : witness_touched_) {
+        witness_weights_[vertex].reset();
+    }
+    witness_touched_.clear();
+}
+
+template <typename Weight>
+int ContractionHierarchy<Weight>::SimulateContraction(VertexId vertex) {
+    pending_shortcuts_.clear();
+    int removed_arcs = 0;
+
+    size_t targets_count = 0;
+    for (const Arc& out_arc : out_arcs_[vertex]) {
+        if (!contracted_[out_arc.to]) {
+            witness_targets_[out_arc.to] = true;
+            ++targets_count;
+            ++removed_arcs;
+        }
+    }
+
+    for (const Arc& in_arc : in_arcs_[vertex]) {
+        const VertexId from = in_arc.to;
+        if (contracted_[from]) {
+            continue;
+        }
+        ++removed_arcs;
+
+        Weight limit = ZERO_WEIGHT;
+        for (const Arc& out_arc : out_arcs_[vertex]) {
+            if (!contracted_[out_arc.to] && out_arc.to != from) {
+                limit = std::max(limit, in_arc.weight + out_arc.weight);
+            }
+        }
+
+        WitnessSearch(from, vertex, limit, targets_count);
+
+        for (const Arc& out_arc : out_arcs_[vertex]) {
+            if (contracted_[out_arc.to] || out_arc.to == from) {
+                continue;
+            }
+            const Weight via_weight = in_arc.weight + out_arc.weight;
+            if (const auto& witness_weight = witness_weights_[out_arc.to]; witness_weight && !(via_weight < *witness_weight)) {
+                continue;
+            }
+            pending_shortcuts_.push_back({from, out_arc.to, via_weight, in_arc.edge_id, out_arc.edge_id});
+        }
+        ResetWitnessSearch();
+    }
+
+    for (const Arc& out_arc : out_arcs_[vertex]) {
+        witness_targets_[out_arc.to] = false;
+    }
+
+    return static_cast<int>(pending_shortcuts_.size()) - removed_arcs;
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::ApplyContraction(VertexId vertex) {
+    for (const auto& shortcut : pending_shortcuts_) {
+        const EdgeId edge_id = graph_.GetEdgeCount() + shortcuts_.size();
+        shortcuts_.push_back(shortcut);
+        AddOrUpdateArc(out_arcs_[shortcut.from], {shortcut.to, shortcut.weight, edge_id});
+        AddOrUpdateArc(in_arcs_[shortcut.to], {shortcut.from, shortcut.weight, edge_id});
+    }
+    pending_shortcuts_.clear();
+
+    for (const Arc& arc : out_arcs_[vertex]) {
+        ++contracted_neighbours_[arc.to];
+    }
+    for (const Arc& arc : in_arcs_[vertex]) {
+        ++contracted_neighbours_[arc.to];
+    }
+    contracted_[vertex] = true;
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::Contract() {
+    const size_t vertex_count = graph_.GetVertexCount();
+
+    out_arcs_.assign(vertex_count, {});
+    in_arcs_.assign(vertex_count, {});
+    contracted_.assign(vertex_count, false);
+    contracted_neighbours_.assign(vertex_count, 0);
+    witness_weights_.assign(vertex_count, std::nullopt);
+    witness_targets_.assign(vertex_count, false);
+    ranks_.assign(vertex_count, 0);
+
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        if (edge.from == edge.to) {
+            continue;
+        }
+        AddOrUpdateArc(out_arcs_[edge.from], {edge.to, edge.weight, edge_id});
+        AddOrUpdateArc(in_arcs_[edge.to], {edge.from, edge.weight, edge_id});
+    }
+
+    // lazy updated queue ordered by edge difference plus contracted neighbours
+    using QueueItem = std::pair<int, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        queue.push({SimulateContraction(vertex), vertex});
+    }
+
+    size_t rank = 0;
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+
+        const int priority = SimulateContraction(vertex) + contracted_neighbours_[vertex];
+        if (!queue.empty() && priority > queue.top().first) {
+            queue.push({priority, vertex});
+            continue;
+        }
+
+        // shortcuts found by the simulation above are still valid
+        ApplyContraction(vertex);
+        ranks_[vertex] = rank++;
+    }
+
+    out_arcs_.clear();
+    in_arcs_.clear();
+    contracted_.clear();
+    contracted_neighbours_.clear();
+    witness_weights_.clear();
+    witness_targets_.clear();
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::BuildUpwardGraph() {
+    upward_arcs_.assign(graph_.GetVertexCount(), {});
+    downward_arcs_.assign(graph_.GetVertexCount(), {});
+
+    auto add_arc = [this](VertexId from, VertexId to, Weight weight, EdgeId edge_id) {
+        if (from == to) {
+            return;
+        }
+        if (ranks_[from] < ranks_[to]) {
+            upward_arcs_[from].push_back({to, weight, edge_id});
+        } else {
+            downward_arcs_[to].push_back({from, weight, edge_id});
+        }
+    };
+
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        add_arc(edge.from, edge.to, edge.weight, edge_id);
+    }
+    for (size_t i = 0; i < shortcuts_.size(); ++i) {
+        const auto& shortcut = shortcuts_[i];
+        add_arc(shortcut.from, shortcut.to, shortcut.weight, graph_.GetEdgeCount() + i);
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+    // shortcuts nest as deep as the hierarchy goes, so they are unpacked with a stack of their own
+    std::vector<EdgeId> pending{edge_id};
+    while (!pending.empty()) {
+        const EdgeId id = pending.back();
+        pending.pop_back();
+        if (id < graph_.GetEdgeCount()) {
+            edges.push_back(id);
+            continue;
+        }
+        const auto& shortcut = shortcuts_[id - graph_.GetEdgeCount()];
+        pending.push_back(shortcut.second_edge);
+        pending.push_back(shortcut.first_edge);
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(VertexId from,
+                                                                                                         VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        return std::nullopt;
+    }
+
+    struct Label {
+        Weight weight;
+        std::optional<EdgeId> edge;     // ch edge the vertex was reached by
+        VertexId parent;
+    };
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    // index 0 - forward search from 'from', index 1 - backward search from 'to'
+    std::unordered_map<VertexId, Label> labels[2];
+    Queue queues[2];
+    const std::vector<ArcList>* arcs[2] = {&upward_arcs_, &downward_arcs_};
+
+    labels[0][from] = {ZERO_WEIGHT, std::nullopt, from};
+    labels[1][to] = {ZERO_WEIGHT, std::nullopt, to};
+    queues[0].push({ZERO_WEIGHT, from});
+    queues[1].push({ZERO_WEIGHT, to});
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+
+    auto update_best = [&](VertexId vertex) {
+        auto forward = labels[0].find(vertex);
+        auto backward = labels[1].find(vertex);
+        if (forward == labels[0].end() || backward == labels[1].end()) {
+            return;
+        }
+        const Weight weight = forward->second.weight + backward->second.weight;
+        if (!best_weight || weight < *best_weight) {
+            best_weight = weight;
+            meeting_vertex = vertex;
+        }
+    };
+
+    update_best(from);
+
+    for (size_t side = 0; !queues[0].empty() || !queues[1].empty(); side ^= 1) {
+        auto& queue = queues[side];
+        // search stops when its frontier can't improve the best route anymore
+        if (queue.empty() || (best_weight && !(queue.top().first < *best_weight))) {
+            queue = Queue{};
+            continue;
+        }
+
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (labels[side][vertex].weight < weight) {
+            continue;
+        }
+
+        for (const Arc& arc : (*arcs[side])[vertex]) {
+            const Weight candidate_weight = weight + arc.weight;
+            auto it = labels[side].find(arc.to);
+            if (it == labels[side].end() || candidate_weight < it->second.weight) {
+                labels[side][arc.to] = {candidate_weight, arc.edge_id, vertex};
+                queue.push({candidate_weight, arc.to});
+                update_best(arc.to);
+            }
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> ch_edges;
+    for (VertexId vertex = meeting_vertex; labels[0][vertex].edge; vertex = labels[0][vertex].parent) {
+        ch_edges.push_back(*labels[0][vertex].edge);
+    }
+    std::reverse(ch_edges.begin(), ch_edges.end());
+    for (VertexId vertex = meeting_vertex; labels[1][vertex].edge; vertex = labels[1][vertex].parent) {
+        ch_edges.push_back(*labels[1][vertex].edge);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const EdgeId edge_id : ch_edges) {
+        UnpackEdge(edge_id, edges);
+    }
+
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "graph.h"
+#include "ranges.h"
+
+#include <vector>
+
+namespace graph {
+
+// immutable compressed sparse row copy of DirectedWeightedGraph:
+// incident edges of a vertex are one contiguous run of (to, weight) pairs
+template <typename Weight>
+class CsrGraph {
+
+public:
+    struct IncidentEdge {
+        VertexId to;
+        Weight weight;
+    };
+
+    using IncidentEdgesRange = ranges::Range<const IncidentEdge*>;
+
+    CsrGraph() = default;
+
+    /* reversed - runs hold incoming edges instead, IncidentEdge::to is then the edge's tail */
+    explicit CsrGraph(const DirectedWeightedGraph<Weight>& graph, bool reversed = false);
+
+    size_t GetVertexCount() const{
+        return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+
+    size_t GetEdgeCount() const{
+        return edges_.size();
+    }
+
+    IncidentEdgesRange GetIncidentEdges(VertexId vertex) const{
+        return {edges_.data() + offsets_[vertex], edges_.data() + offsets_[vertex + 1]};
+    }
+
+    /* id in the source graph, edge must be taken from GetIncidentEdges */
+    EdgeId GetEdgeId(const IncidentEdge& edge) const{
+        return edge_ids_[&edge - edges_.data()];
+    }
+
+private:
+    std::vector<size_t> offsets_;       // vertex count + 1 entries
+    std::vector<IncidentEdge> edges_;
+    std::vector<EdgeId> edge_ids_;      // kept apart, only needed when a route is recorded
+};
+
+template <typename Weight>
+CsrGraph<Weight>::CsrGraph(const DirectedWeightedGraph<Weight>& graph, bool reversed)
+    : offsets_(graph.GetVertexCount() + 1, 0)
+    , edges_(graph.GetEdgeCount())
+    , edge_ids_(graph.GetEdgeCount())
+{
+    for (const auto& edge : graph.GetEdges()) {
+        ++offsets_[(reversed ? edge.to : edge.from) + 1];
+    }
+    for (size_t vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+        offsets_[vertex + 1] += offsets_[vertex];
+    }
+
+    // edges go in id order, so every run keeps the incidence list order
+    std::vector<size_t> positions(offsets_.begin(), offsets_.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        const VertexId tail = reversed ? edge.to : edge.from;
+        const VertexId head = reversed ? edge.from : edge.to;
+        const size_t position = positions[tail]++;
+        edges_[position] = {head, edge.weight};
+        edge_ids_[position] = edge_id;
+    }
+}
+
+}  // namespace graph
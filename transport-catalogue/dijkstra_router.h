@@ -0,0 +1,267 @@
+#pragma once
+
+#include "csr_graph.h"
+#include "graph.h"
+#include "routing_engine.h"
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// single-source Dijkstra engine: no preprocessing, O(E log V) per query,
+// optionally keeps shortest path trees of repeating sources in a bounded LRU cache
+template <typename Weight>
+class DijkstraRouter : public RoutingEngine<Weight> {
+
+public:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using RouteInfo = typename RoutingEngine<Weight>::RouteInfo;
+
+    /* cache_capacity - amount of per-source trees to keep, 0 disables caching */
+    explicit DijkstraRouter(const Graph& graph, size_t cache_capacity = 0);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    size_t GetCacheCapacity() const{
+        return cache_capacity_;
+    }
+
+private:
+
+    struct RouteInternalData {
+        Weight weight;
+        std::optional<EdgeId> prev_edge;
+    };
+
+    using ShortestPathTree = std::vector<std::optional<RouteInternalData>>;
+
+    // search arrays, unreached vertices have no tree entry and aren't settled
+    struct SearchState {
+        ShortestPathTree tree;
+        std::vector<bool> settled;
+        std::vector<VertexId> touched;
+    };
+
+    /* runs search from 'from' in a clean state, stops as soon as 'to' is settled if given */
+    void Search(SearchState& state, VertexId from, std::optional<VertexId> to) const;
+
+    ShortestPathTree BuildTree(VertexId from) const;
+
+    /* route to 'to' from the source of the tree */
+    std::optional<RouteInfo> RestoreRoute(const ShortestPathTree& tree, VertexId to) const;
+
+    /* searches stopped at a target reuse arrays of earlier ones, so they don't pay for the whole graph.
+       A state is used by one query at a time and is clean again when returned */
+    std::optional<RouteInfo> BuildRouteWithReusedState(VertexId from, VertexId to) const;
+
+    /* null for a new source, its query only searches up to the target.
+       The whole tree is built and kept once the source repeats */
+    std::shared_ptr<const ShortestPathTree> GetCachedTree(VertexId from) const;
+
+    /* cache_mutex_ must be held */
+    void CacheTree(VertexId from, std::shared_ptr<const ShortestPathTree> tree) const;
+
+    Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    CsrGraph<Weight> csr_graph_;    // searched one, graph_ is only used to restore routes
+    size_t cache_capacity_;
+
+    using CacheOrder = std::list<VertexId>;
+    struct CacheEntry {
+        std::shared_ptr<const ShortestPathTree> tree;   // null while the source was seen only once
+        typename CacheOrder::iterator order_it;
+    };
+
+    mutable std::mutex cache_mutex_;
+    mutable CacheOrder cache_order_; // most recently used first
+    mutable std::unordered_map<VertexId, CacheEntry> cache_;
+
+    mutable std::mutex states_mutex_;
+    mutable std::vector<std::unique_ptr<SearchState>> free_states_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, size_t cache_capacity)
+    : graph_(graph)
+    , csr_graph_(graph)
+    , cache_capacity_(cache_capacity)
+{
+    for (const auto& edge : graph_.GetEdges()) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+void DijkstraRouter<Weight>::Search(SearchState& state, VertexId from, std::optional<VertexId> to) const {
+
+    auto& tree = state.tree;
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+    tree[from] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+    state.touched.push_back(from);
+    queue.push({ZERO_WEIGHT, from});
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+
+        if (state.settled[vertex]) {
+            continue;
+        }
+        state.settled[vertex] = true;
+
+        if (to && *to == vertex) {
+            break;
+        }
+
+        for (const auto& edge : csr_graph_.GetIncidentEdges(vertex)) {
+            const Weight candidate_weight = weight + edge.weight;
+            auto& route = tree[edge.to];
+            if (!route || candidate_weight < route->weight) {
+                if (!route) {
+                    state.touched.push_back(edge.to);
+                }
+                route = RouteInternalData{candidate_weight, csr_graph_.GetEdgeId(edge)};
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::ShortestPathTree DijkstraRouter<Weight>::BuildTree(VertexId from) const {
+    SearchState state{ShortestPathTree(csr_graph_.GetVertexCount()), std::vector<bool>(csr_graph_.GetVertexCount(), false), {}};
+    Search(state, from, std::nullopt);
+    return std::move(state.tree);
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::RestoreRoute(const ShortestPathTree& tree,
+                                                                                               VertexId to) const {
+    const auto& route_internal_data = tree[to];
+    if (!route_internal_data) {
+        return std::nullopt;
+    }
+    const Weight weight = route_internal_data->weight;
+    std::vector<EdgeId> edges;
+
+    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
+         edge_id;
+         edge_id = tree[graph_.GetEdge(*edge_id).from]->prev_edge)
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{weight, std::move(edges)};
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRouteWithReusedState(VertexId from,
+                                                                                                            VertexId to) const {
+    std::unique_ptr<SearchState> state;
+    {
+        std::lock_guard guard(states_mutex_);
+        if (!free_states_.empty()) {
+            state = std::move(free_states_.back());
+            free_states_.pop_back();
+        }
+    }
+    if (!state) {
+        state = std::make_unique<SearchState>();
+        state->tree.resize(csr_graph_.GetVertexCount());
+        state->settled.resize(csr_graph_.GetVertexCount(), false);
+    }
+
+    Search(*state, from, to);
+    auto route = RestoreRoute(state->tree, to);
+
+    for (const VertexId vertex : state->touched) {
+        state->tree[vertex].reset();
+        state->settled[vertex] = false;
+    }
+    state->touched.clear();
+
+    std::lock_guard guard(states_mutex_);
+    free_states_.push_back(std::move(state));
+
+    return route;
+}
+
+template <typename Weight>
+void DijkstraRouter<Weight>::CacheTree(VertexId from, std::shared_ptr<const ShortestPathTree> tree) const {
+    if (auto it = cache_.find(from); it != cache_.end()) {
+        cache_order_.splice(cache_order_.begin(), cache_order_, it->second.order_it);
+        if (tree) {
+            it->second.tree = std::move(tree);
+        }
+        return;
+    }
+    if (cache_.size() >= cache_capacity_) {
+        cache_.erase(cache_order_.back());
+        cache_order_.pop_back();
+    }
+    cache_order_.push_front(from);
+    cache_.insert({from, CacheEntry{std::move(tree), cache_order_.begin()}});
+}
+
+template <typename Weight>
+std::shared_ptr<const typename DijkstraRouter<Weight>::ShortestPathTree>
+DijkstraRouter<Weight>::GetCachedTree(VertexId from) const {
+    bool repeated = false;
+    {
+        std::lock_guard guard(cache_mutex_);
+        if (auto it = cache_.find(from); it != cache_.end()) {
+            if (it->second.tree) {
+                cache_order_.splice(cache_order_.begin(), cache_order_, it->second.order_it);
+                return it->second.tree;
+            }
+            repeated = true;
+        }
+        CacheTree(from, nullptr);
+    }
+
+    // a single query from the source doesn't pay for the whole tree
+    if (!repeated) {
+        return nullptr;
+    }
+
+    // searching without the lock, concurrent misses on one source just do the work twice
+    auto tree = std::make_shared<const ShortestPathTree>(BuildTree(from));
+
+    std::lock_guard guard(cache_mutex_);
+    CacheTree(from, tree);
+
+    return tree;
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        return std::nullopt;
+    }
+
+    if (cache_capacity_) {
+        if (auto tree = GetCachedTree(from)) {
+            return RestoreRoute(*tree, to);
+        }
+    }
+
+    return BuildRouteWithReusedState(from, to);
+}
+
+}  // namespace graph
@@ -7,8 +7,34 @@
 
 namespace TC {
 
+    enum class request_type_t{
+        UNKNOWN,    // dropped by make_base, answered with null
+        BUS,
+        STOP,
+        MAP,
+        ROUTE,
+        ROUTE_MATRIX,
+    };
+
+    /* "type" field of a request is compared once, here */
+    inline request_type_t ParseRequestType(std::string_view type){
+        using namespace std::literals;
+
+        if(type == "Bus"sv)
+            return request_type_t::BUS;
+        if(type == "Stop"sv)
+            return request_type_t::STOP;
+        if(type == "Map"sv)
+            return request_type_t::MAP;
+        if(type == "Route"sv)
+            return request_type_t::ROUTE;
+        if(type == "RouteMatrix"sv)
+            return request_type_t::ROUTE_MATRIX;
+        return request_type_t::UNKNOWN;
+    }
+
     struct base_request_t {
-            std::string_view type;
+            request_type_t type = request_type_t::UNKNOWN;
             std::string_view name;
 
             std::vector<std::string_view> stops;
@@ -20,6 +46,21 @@ namespace TC {
             std::unordered_map<std::string_view, uint32_t> road_distances;
     };
 
+    /* stat request with its fields already read, answering it doesn't go back to the reader.
+       Strings are slices of the reader's document */
+    struct stat_request_t {
+            int id = 0;
+            request_type_t type = request_type_t::UNKNOWN;
+
+            std::string_view name;  // Bus, Stop
+
+            std::string_view from;  // Route
+            std::string_view to;
+
+            std::vector<std::string_view> from_stops;   // RouteMatrix
+            std::vector<std::string_view> to_stops;
+    };
+
     struct map_settings_t {
         double width;
         double height;
@@ -40,38 +81,72 @@ namespace TC {
         std::vector<svg::Color> color_palette;
     };
 
+    enum class router_type_t{
+        AUTO,       // picked by TransportRouter depending on network size
+        ALL_PAIRS,  // precomputed Floyd–Warshall matrix
+        DIJKSTRA,   // search per request
+        CONTRACTION_HIERARCHY, // contracted at make_base, bidirectional search per request
+        ASTAR,      // bidirectional search per request guided by stop coordinates
+    };
+
+    enum class graph_model_t{
+        COMPLETE,   // edge for every pair of stops along a bus, quadratic in route length
+        COMPACT,    // wait and ride vertices, edges only between neighbour stops
+    };
+
     struct routing_settings_t{
         int bus_velocity_kmh;   // km/h
         int bus_wait_time_min;  // minutes
+        router_type_t router_type = router_type_t::AUTO;
+        graph_model_t graph_model = graph_model_t::COMPLETE;
+    };
+
+    enum class base_format_t{
+        FLAT,       // sections of fixed-width records, mapped and used in place
+        PROTOBUF,   // BusManager message, for tools reading older bases
+    };
+
+    struct serialization_settings_t{
+        std::string_view file;
+        base_format_t format = base_format_t::FLAT;    // written format, reading takes any
     };
 
     template <typename Array, typename Dict, typename Node>
     class Reader {
         public:
 
+        virtual const Node& GetRootNode() = 0;
+        virtual bool HasRequestNodes(std::string_view name) = 0;
         virtual const Array& GetRequestNodesAsArray(std::string_view name) = 0;
         virtual const Dict& GetRequestNodesAsMap(std::string_view name) = 0;
 
-        virtual const std::string& GetFieldAsString(const Node& node, std::string_view name) = 0;
-        virtual const std::string& GetFieldAsString(const Dict& node, std::string_view name) = 0;
+        virtual std::string_view GetFieldAsString(const Node& node, std::string_view name) = 0;
+        virtual std::string_view GetFieldAsString(const Dict& node, std::string_view name) = 0;
         virtual bool GetFieldAsBool(const Node& node, std::string_view name) = 0;
         virtual double GetFieldAsDouble(const Node& node, std::string_view name) = 0;
         virtual int GetFieldAsInt(const Node& node, std::string_view name) = 0;
 
+        virtual bool HasField(const Node& node, std::string_view name) = 0;
+
         virtual const Node& GetFieldAsNode(const Node& node, std::string_view name) = 0;
 
         virtual const Array& GetFieldAsArrayNodes(const Node& node, std::string_view name) = 0;
         virtual const Dict& GetFieldAsMapNodes(const Node& node, std::string_view name) = 0;
 
+        /* readers that parse base_requests straight into base_request_t give them here,
+           nullptr means they are only available as nodes */
+        virtual std::vector<base_request_t>* GetParsedBaseRequests() = 0;
+
         virtual ~Reader() {};
     };
 
     class Renderer {
         public:
 
+        /* has to be safe to call concurrently, settings are set before */
         virtual void Render(std::vector<const Bus*>  buses, 
                     std::vector<const Stop*>  stops, 
-                    std::ostream& output) = 0;
+                    std::ostream& output) const = 0;
 
         virtual void SetSettings(map_settings_t& settings) = 0;
 
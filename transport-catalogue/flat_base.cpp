@@ -0,0 +1,140 @@
+#include "flat_base.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace TC::FlatBase {
+
+    namespace {
+
+        constexpr uint64_t sectionAlignment = 8;
+
+        bool IsLittleEndian(){
+            const uint16_t value = 1;
+            unsigned char first_byte;
+            std::memcpy(&first_byte, &value, 1);
+            return first_byte == 1;
+        }
+
+        [[noreturn]] void ThrowCorrupted(){
+            throw std::runtime_error("Base file is corrupted");
+        }
+
+    } // namespace
+
+    bool IsFlatBase(const io::MappedFile& file){
+        return file.GetSize() >= sizeof(Header) && std::memcmp(file.GetData(), magic, sizeof(magic)) == 0;
+    }
+
+    Writer::Writer(std::ostream& out) : out_(out){
+
+        if(!IsLittleEndian())
+            throw std::runtime_error("Flat bases are written on little-endian hosts only");
+
+        // filled in by Finish
+        const Header header{};
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        offset_ = sizeof(header);
+    }
+
+    uint64_t Writer::WriteBytes(const void* data, uint64_t size){
+
+        const char padding[sectionAlignment] = {};
+        const uint64_t offset = (offset_ + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+        out_.write(padding, offset - offset_);
+
+        out_.write(static_cast<const char*>(data), size);
+        offset_ = offset + size;
+
+        return offset;
+    }
+
+    void Writer::WriteSectionBytes(Section id, uint32_t record_size, const void* data, size_t count){
+        const uint64_t offset = WriteBytes(data, static_cast<uint64_t>(record_size) * count);
+        toc_.push_back({static_cast<uint32_t>(id), record_size, offset, count});
+    }
+
+    void Writer::Finish(){
+
+        Header header;
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.section_count = static_cast<uint32_t>(toc_.size());
+        header.toc_offset = WriteBytes(toc_.data(), toc_.size() * sizeof(SectionEntry));
+        header.file_size = offset_;
+
+        out_.seekp(0);
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out_.flush();
+
+        if(!out_)
+            throw std::runtime_error("Can't write the base");
+    }
+
+    Reader::Reader(std::shared_ptr<const io::MappedFile> file) : file_(std::move(file)){
+
+        if(!IsLittleEndian())
+            throw std::runtime_error("Flat bases are read on little-endian hosts only");
+
+        if(!IsFlatBase(*file_))
+            throw std::runtime_error("Not a flat base");
+
+        Header header;
+        std::memcpy(&header, file_->GetData(), sizeof(header));
+
+        if(header.version != version)
+            throw std::runtime_error("Unsupported base version " + std::to_string(header.version));
+
+        if(header.file_size != file_->GetSize()
+            || header.toc_offset % sectionAlignment != 0
+            || header.toc_offset < sizeof(Header)
+            || header.toc_offset > header.file_size
+            || header.section_count > (header.file_size - header.toc_offset) / sizeof(SectionEntry)){
+            ThrowCorrupted();
+        }
+
+        toc_ = reinterpret_cast<const SectionEntry*>(file_->GetData() + header.toc_offset);
+        section_count_ = header.section_count;
+
+        for(size_t i = 0; i < section_count_; ++i){
+            const auto& entry = toc_[i];
+            if(entry.offset % sectionAlignment != 0
+                || entry.offset < sizeof(Header)
+                || entry.offset > header.toc_offset
+                || (entry.record_size && entry.count > (header.toc_offset - entry.offset) / entry.record_size)){
+                ThrowCorrupted();
+            }
+        }
+
+        const auto names = GetSection<char>(Section::NAMES);
+        names_ = std::string_view(names.begin(), names.end() - names.begin());
+    }
+
+    std::string_view Reader::GetName(Name name) const{
+        if(name.offset > names_.size() || name.size > names_.size() - name.offset){
+            ThrowCorrupted();
+        }
+        return names_.substr(name.offset, name.size);
+    }
+
+    std::pair<const void*, size_t> Reader::FindSection(Section id, size_t record_size) const{
+
+        for(size_t i = 0; i < section_count_; ++i){
+            const auto& entry = toc_[i];
+            if(entry.id != static_cast<uint32_t>(id)){
+                continue;
+            }
+            if(entry.record_size != record_size){
+                throw std::runtime_error("Base section " + std::to_string(entry.id) + " has unexpected records");
+            }
+            return {file_->GetData() + entry.offset, entry.count};
+        }
+        return {nullptr, 0};
+    }
+
+    void Reader::ThrowMissing(Section id){
+        throw std::runtime_error("Base has no section " + std::to_string(static_cast<uint32_t>(id)));
+    }
+
+} // namespace TC::FlatBase
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "ranges.h"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace TC::FlatBase {
+
+/* base file without a parsing step: a header, sections of fixed-width little-endian records
+   and the table of contents after them. Sections start 8-byte aligned, so a mapped file
+   is used as arrays of the records below in place. Big-endian hosts are refused */
+
+constexpr char magic[8] = {'T', 'C', 'F', 'L', 'A', 'T', 'B', '1'};
+constexpr uint32_t version = 1;
+
+enum class Section : uint32_t {
+    NAMES = 1,              // chars of every name, records refer to them by offset and size
+    STOPS = 2,
+    BUSES = 3,
+    BUS_STOPS = 4,          // stop indexes of all buses one after another
+    DISTANCES = 5,
+    RENDER_SETTINGS = 6,    // single record
+    COLOR_PALETTE = 7,
+    ROUTING_SETTINGS = 8,   // single record
+    EDGES = 9,
+    EDGE_INFOS = 10,
+    CH_RANKS = 11,
+    CH_SHORTCUTS = 12,
+    ROUTES_MATRIX = 13,     // RoutesMatrix cells, all-pairs router only
+    STOP_NAME_INDEX = 14,   // stop indexes in ascending name order
+    BUS_NAME_INDEX = 15,    // bus indexes in ascending name order
+    BUS_STATS = 16,         // per bus, what GetBusStat answers
+    STOP_BUS_RANGES = 17,   // per stop, its part of STOP_BUSES
+    STOP_BUSES = 18,        // bus indexes of every stop in ascending name order
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t toc_offset;
+    uint64_t file_size;
+};
+
+struct SectionEntry {
+    uint32_t id;
+    uint32_t record_size;   // checked on load, a changed record layout needs a new version
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct Name {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct Stop {
+    double latitude;
+    double longitude;
+    Name name;
+};
+
+struct Bus {
+    Name name;
+    uint32_t stops_begin;   // in BUS_STOPS
+    uint32_t stops_count;
+    uint32_t is_roundtrip;
+    uint32_t reserved;
+};
+
+struct Range {
+    uint32_t begin;
+    uint32_t count;
+};
+
+struct BusStats {
+    uint32_t stop_count;
+    uint32_t unique_stop_count;
+    uint32_t route_length;
+    uint32_t reserved;
+    double direct_length;
+    double curvature;
+};
+
+struct Distance {
+    uint32_t from;
+    uint32_t to;
+    uint32_t distance;
+};
+
+enum class ColorType : uint32_t {
+    NONE = 0,
+    RGB = 1,
+    RGBA = 2,
+    STRING = 3,
+};
+
+struct Color {
+    ColorType type;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t reserved;
+    double opacity;
+    Name name;  // STRING only
+};
+
+struct RenderSettings {
+    double width;
+    double height;
+    double padding;
+    double line_width;
+    double stop_radius;
+    double bus_label_offset_x;
+    double bus_label_offset_y;
+    double stop_label_offset_x;
+    double stop_label_offset_y;
+    double underlayer_width;
+    int32_t bus_label_font_size;
+    int32_t stop_label_font_size;
+    Color underlayer_color;
+};
+
+// router_type_t, graph_model_t and EdgeType are stored as their values, their order is part of the format
+struct RoutingSettings {
+    uint32_t bus_velocity_kmh;
+    uint32_t bus_wait_time_min;
+    uint32_t router_type;
+    uint32_t graph_model;
+    uint64_t vertex_count;
+};
+
+struct Edge {
+    uint32_t from;
+    uint32_t to;
+    uint64_t weight;
+};
+
+struct EdgeInfo {
+    uint32_t type;
+    uint32_t bus_id;
+    uint32_t from;
+    uint32_t to;
+    uint32_t distance_m;
+    uint32_t span_count;
+};
+
+struct Shortcut {
+    uint32_t from;
+    uint32_t to;
+    uint64_t weight;
+    uint32_t first_edge;
+    uint32_t second_edge;
+};
+
+static_assert(sizeof(Header) == 32 && sizeof(SectionEntry) == 24);
+static_assert(sizeof(Stop) == 24 && sizeof(Bus) == 24 && sizeof(Distance) == 12 && sizeof(Color) == 24);
+static_assert(sizeof(Range) == 8 && sizeof(BusStats) == 32);
+static_assert(sizeof(RenderSettings) == 112 && sizeof(RoutingSettings) == 24);
+static_assert(sizeof(Edge) == 16 && sizeof(EdgeInfo) == 24 && sizeof(Shortcut) == 24);
+
+/* true if the file starts as a flat base, older bases are protobuf messages */
+bool IsFlatBase(const io::MappedFile& file);
+
+/* sections go straight to out, nothing is kept but the table of contents */
+class Writer {
+public:
+    /* throws std::runtime_error on big-endian hosts */
+    explicit Writer(std::ostream& out);
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    template <typename Record>
+    void WriteSection(Section id, const Record* records, size_t count){
+        static_assert(std::is_trivially_copyable_v<Record>);
+        WriteSectionBytes(id, sizeof(Record), records, count);
+    }
+
+    template <typename Record>
+    void WriteSection(Section id, const std::vector<Record>& records){
+        WriteSection(id, records.data(), records.size());
+    }
+
+    /* writes the table of contents and fills in the header, throws std::runtime_error if out failed */
+    void Finish();
+
+private:
+    /* pads to the section alignment first, gives the offset of data */
+    uint64_t WriteBytes(const void* data, uint64_t size);
+    void WriteSectionBytes(Section id, uint32_t record_size, const void* data, size_t count);
+
+    std::ostream& out_;
+    uint64_t offset_ = 0;
+    std::vector<SectionEntry> toc_;
+};
+
+/* checks the header and the table of contents once, sections are then handed out in place */
+class Reader {
+public:
+    /* throws std::runtime_error if the file is not a flat base of this version or is corrupted */
+    explicit Reader(std::shared_ptr<const io::MappedFile> file);
+
+    /* records of the section, empty if the base doesn't have it.
+       Throws std::runtime_error if the stored record size is not the one of Record */
+    template <typename Record>
+    ranges::Range<const Record*> GetSection(Section id) const{
+        static_assert(std::is_trivially_copyable_v<Record>);
+        const auto [data, count] = FindSection(id, sizeof(Record));
+        const auto* records = static_cast<const Record*>(data);
+        return {records, records + count};
+    }
+
+    /* record of a single record section, throws std::runtime_error if it's missing */
+    template <typename Record>
+    const Record& GetRecord(Section id) const{
+        const auto records = GetSection<Record>(id);
+        if(records.begin() == records.end()){
+            ThrowMissing(id);
+        }
+        return *records.begin();
+    }
+
+    std::string_view GetName(Name name) const;
+
+    const std::shared_ptr<const io::MappedFile>& GetFile() const{
+        return file_;
+    }
+
+private:
+    std::pair<const void*, size_t> FindSection(Section id, size_t record_size) const;
+    [[noreturn]] static void ThrowMissing(Section id);
+
+    std::shared_ptr<const io::MappedFile> file_;
+    const SectionEntry* toc_ = nullptr;
+    size_t section_count_ = 0;
+    std::string_view names_;
+};
+
+}  // namespace TC::FlatBase
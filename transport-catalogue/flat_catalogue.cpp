@@ -0,0 +1,91 @@
+#include "flat_catalogue.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace TC {
+
+namespace {
+
+    [[noreturn]] void ThrowCorruptedBase(){
+        throw std::runtime_error("Base file is corrupted");
+    }
+
+    template <typename Record>
+    size_t Size(ranges::Range<const Record*> records){
+        return static_cast<size_t>(records.end() - records.begin());
+    }
+
+    template <typename Record>
+    const Record& At(ranges::Range<const Record*> records, size_t index){
+        if(index >= Size(records)){
+            ThrowCorruptedBase();
+        }
+        return records.begin()[index];
+    }
+
+    /* index holds record indexes in ascending name order */
+    template <typename Record>
+    std::optional<uint32_t> FindByName(const FlatBase::Reader& reader, ranges::Range<const uint32_t*> index
+                                        , ranges::Range<const Record*> records, std::string_view name){
+
+        const auto it = std::lower_bound(index.begin(), index.end(), name, [&](uint32_t record, std::string_view name){
+            return reader.GetName(At(records, record).name) < name;
+        });
+
+        if(it == index.end() || reader.GetName(At(records, *it).name) != name){
+            return std::nullopt;
+        }
+        return *it;
+    }
+
+} // namespace
+
+    FlatCatalogue::FlatCatalogue(std::shared_ptr<const io::MappedFile> base_file)
+        : reader_(std::move(base_file))
+        , stops_(reader_.GetSection<FlatBase::Stop>(FlatBase::Section::STOPS))
+        , buses_(reader_.GetSection<FlatBase::Bus>(FlatBase::Section::BUSES))
+        , stop_name_index_(reader_.GetSection<uint32_t>(FlatBase::Section::STOP_NAME_INDEX))
+        , bus_name_index_(reader_.GetSection<uint32_t>(FlatBase::Section::BUS_NAME_INDEX))
+        , bus_stats_(reader_.GetSection<FlatBase::BusStats>(FlatBase::Section::BUS_STATS))
+        , stop_bus_ranges_(reader_.GetSection<FlatBase::Range>(FlatBase::Section::STOP_BUS_RANGES))
+        , stop_buses_(reader_.GetSection<uint32_t>(FlatBase::Section::STOP_BUSES)){
+    }
+
+    bool FlatCatalogue::HasLookups() const{
+        // older bases have stops and buses but none of these, an empty base has nothing to look up either way
+        return Size(stop_name_index_) == Size(stops_) && Size(bus_name_index_) == Size(buses_)
+            && Size(bus_stats_) == Size(buses_) && Size(stop_bus_ranges_) == Size(stops_);
+    }
+
+    const FlatBase::BusStats* FlatCatalogue::FindBusStats(std::string_view name) const{
+
+        const auto bus = FindByName(reader_, bus_name_index_, buses_, name);
+        if(!bus){
+            return nullptr;
+        }
+        return &At(bus_stats_, *bus);
+    }
+
+    std::optional<std::vector<std::string_view>> FlatCatalogue::FindStopBuses(std::string_view name) const{
+
+        const auto stop = FindByName(reader_, stop_name_index_, stops_, name);
+        if(!stop){
+            return std::nullopt;
+        }
+
+        const auto& range = At(stop_bus_ranges_, *stop);
+        if(range.begin > Size(stop_buses_) || range.count > Size(stop_buses_) - range.begin){
+            ThrowCorruptedBase();
+        }
+
+        std::vector<std::string_view> buses;
+        buses.reserve(range.count);
+        for(size_t i = range.begin; i < range.begin + range.count; ++i){
+            buses.push_back(reader_.GetName(At(buses_, stop_buses_.begin()[i]).name));
+        }
+        return buses;
+    }
+
+} // TC
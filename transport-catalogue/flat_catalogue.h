@@ -0,0 +1,45 @@
+#pragma once
+
+#include "flat_base.h"
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace TC {
+
+/* read-only catalogue over a mapped flat base: bus and stop queries are answered
+   from the stored name indexes and precomputed stats, nothing is deserialized.
+   Every record is bounds checked when it's used, the file is not walked on open */
+class FlatCatalogue {
+public:
+    /* throws std::runtime_error if the file is not a flat base */
+    explicit FlatCatalogue(std::shared_ptr<const io::MappedFile> base_file);
+
+    /* false for bases written before the lookup sections were added */
+    bool HasLookups() const;
+
+    /* nullptr if there is no such bus */
+    const FlatBase::BusStats* FindBusStats(std::string_view name) const;
+
+    /* names of the buses through the stop in ascending order, nullopt if there is no such stop */
+    std::optional<std::vector<std::string_view>> FindStopBuses(std::string_view name) const;
+
+    const FlatBase::Reader& GetReader() const{
+        return reader_;
+    }
+
+private:
+    FlatBase::Reader reader_;
+
+    ranges::Range<const FlatBase::Stop*> stops_;
+    ranges::Range<const FlatBase::Bus*> buses_;
+    ranges::Range<const uint32_t*> stop_name_index_;
+    ranges::Range<const uint32_t*> bus_name_index_;
+    ranges::Range<const FlatBase::BusStats*> bus_stats_;
+    ranges::Range<const FlatBase::Range*> stop_bus_ranges_;
+    ranges::Range<const uint32_t*> stop_buses_;
+};
+
+}  // namespace TC
@@ -26,6 +26,8 @@ private:
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
+    /* all edges at once, ids are their positions. Every edge has to be inside vertex_count */
+    DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges);
     EdgeId AddEdge(const Edge<Weight>& edge);
 
     size_t GetVertexCount() const;
@@ -37,7 +39,7 @@ public:
         return edges_;
     } 
 
-    const std::vector<IncidenceList> GetIncidenceLists() const{
+    const std::vector<IncidenceList>& GetIncidenceLists() const{
         return incidence_lists_;
     }
 
@@ -51,6 +53,23 @@ DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
     : incidence_lists_(vertex_count) {
 }
 
+template <typename Weight>
+DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges)
+    : edges_(std::move(edges))
+    , incidence_lists_(vertex_count) {
+
+    std::vector<size_t> degrees(vertex_count);
+    for (const auto& edge : edges_) {
+        ++degrees[edge.from];
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        incidence_lists_[vertex].reserve(degrees[vertex]);
+    }
+    for (EdgeId id = 0; id < edges_.size(); ++id) {
+        incidence_lists_[edges_[id].from].push_back(id);
+    }
+}
+
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
     edges_.push_back((edge));
@@ -1,5 +1,10 @@
 #include "json.h"
 
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <stdexcept>
+
 using namespace std;
 
 namespace json {
@@ -22,7 +27,7 @@ Node LoadArray(istream& input) {
         throw ParsingError("Array error"s);
 
 
-    return Node((result));
+    return Node(move(result));
 }
 
 Node LoadNumber(std::istream& input) {
@@ -77,20 +82,23 @@ Node LoadNumber(std::istream& input) {
         is_int = false;
     }
 
-    try {
-        if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return Node(std::stoi(parsed_num));
-            } catch (...) {
-                // В случае неудачи, например, при переполнении,
-                // код ниже попробует преобразовать строку в double
-            }
+    const char* begin = parsed_num.data();
+    const char* end = begin + parsed_num.size();
+
+    if (is_int) {
+        // Сначала пробуем преобразовать строку в int,
+        // при переполнении код ниже преобразует её в double
+        int value = 0;
+        if (std::from_chars(begin, end, value).ec == std::errc{}) {
+            return Node(value);
         }
-        return Node(std::stod(parsed_num));
-    } catch (...) {
+    }
+
+    double value = 0;
+    if (std::from_chars(begin, end, value).ec != std::errc{}) {
         throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
     }
+    return Node(value);
 }
 
 Node LoadNull(istream& input) {
@@ -182,7 +190,7 @@ Node LoadString(std::istream& input) {
 }
 
 Node LoadDict(istream& input) {
-    Dict result;
+    vector<Dict::value_type> result;
 
     char c = 0;
     for (; input >> c && c != '}';) {
@@ -192,13 +200,13 @@ Node LoadDict(istream& input) {
 
         string key = LoadString(input).AsString();
         input >> c;
-        result.insert({move(key), LoadNode(input)});
+        result.emplace_back(move(key), LoadNode(input));
     }
 
     if (c != '}')
         throw ParsingError("Dict error"s);
 
-    return Node(move(result));
+    return Node(Dict(move(result)));
 }
 
 Node LoadNode(istream& input) {
@@ -229,6 +237,67 @@ Node LoadNode(istream& input) {
 
 }  // namespace
 
+// ---------------------- Dict ---------------------
+Dict::Dict(vector<value_type> items) : items_(move(items)) {
+    auto less = [](const value_type& lhs, const value_type& rhs) {
+        return lhs.first < rhs.first;
+    };
+    if (!is_sorted(items_.begin(), items_.end(), less)) {
+        stable_sort(items_.begin(), items_.end(), less);
+    }
+    items_.erase(unique(items_.begin(), items_.end(), [](const value_type& lhs, const value_type& rhs) {
+        return lhs.first == rhs.first;
+    }), items_.end());
+}
+
+Dict::const_iterator Dict::LowerBound(string_view key) const {
+    return lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, string_view key) {
+        return string_view(item.first) < key;
+    });
+}
+
+Dict::const_iterator Dict::find(string_view key) const {
+    const auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+size_t Dict::count(string_view key) const {
+    return find(key) != end() ? 1 : 0;
+}
+
+const Node& Dict::at(string_view key) const {
+    const auto it = find(key);
+    if (it == end()) {
+        throw out_of_range("Dict has no key "s + string(key));
+    }
+    return it->second;
+}
+
+Node& Dict::operator[](string_view key) {
+    const auto it = LowerBound(key);
+    if (it == end() || it->first != key) {
+        return items_.emplace(it, string(key), Node())->second;
+    }
+    return items_[it - begin()].second;
+}
+
+bool Dict::insert(value_type item) {
+    const auto it = LowerBound(item.first);
+    if (it != end() && it->first == item.first) {
+        return false;
+    }
+    items_.insert(it, move(item));
+    return true;
+}
+
+bool Dict::operator==(const Dict& other) const {
+    return items_ == other.items_;
+}
+
+bool Dict::operator!=(const Dict& other) const {
+    return !(*this == other);
+}
+
 // ---------------------- Node ---------------------
 Node::Node(std::nullptr_t value) : value_(value) {
 }
@@ -248,12 +317,21 @@ Node::Node(double value) : value_(value) {
 Node::Node(const std::string &value) : value_((value)) {
 }
 
+Node::Node(std::string_view value) : value_(std::string(value)) {
+}
+
 Node::Node(const Array &value) : value_((value)) {
 }
 
+Node::Node(Array &&value) : value_(move(value)) {
+}
+
 Node::Node(const Dict &value) : value_((value)){
 }
 
+Node::Node(Dict &&value) : value_(move(value)){
+}
+
 
 
 bool Node::IsInt() const {
@@ -372,18 +450,18 @@ void PrintValue(std::nullptr_t, std::ostream& out) {
     out << "null";
 }
 
+// shortest text that reads back to the same double, stream formatting is not involved
 void PrintValue(double value, std::ostream& out) {
-    int t = cout.precision();
-    out.precision(11);
-    out << value;
-    out.precision(t);
+    char buffer[32];
+    const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    out.write(buffer, result.ptr - buffer);
 }
 
 void PrintValue(bool value, std::ostream& out) {
     out << std::boolalpha << value << std::noboolalpha;
 }
 
-void PrintValue(const string &value, std::ostream& out) {
+void PrintValue(string_view value, std::ostream& out) {
     out << "\"";
     for (auto i = value.begin(); i < value.end(); i++)
     {
@@ -410,11 +488,15 @@ void PrintValue(const string &value, std::ostream& out) {
 }
 
 void PrintValue(int value, std::ostream &out){
-    out << value;
+    char buffer[16];
+    const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    out.write(buffer, result.ptr - buffer);
 }
 
 void PrintValue(uint32_t value, std::ostream &out){
-    out << value;
+    char buffer[16];
+    const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    out.write(buffer, result.ptr - buffer);
 }
 
 void PrintValue(const Array &array, std::ostream &out){
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <iostream>
-#include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 #include <cstdint>
@@ -11,7 +11,40 @@ namespace json {
 
 class Node;
 
-using Dict = std::map<std::string, Node>;
+/* keys in the order std::map keeps them, but in one contiguous block. Lookups are
+   binary searches by string_view, no key strings are made for them */
+class Dict {
+public:
+    using value_type = std::pair<std::string, Node>;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    Dict() = default;
+    /* items in any order, of equal keys the first one is kept as insert does */
+    explicit Dict(std::vector<value_type> items);
+
+    const_iterator begin() const { return items_.begin(); }
+    const_iterator end() const { return items_.end(); }
+    size_t size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+
+    const_iterator find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    /* throws std::out_of_range if there is no key */
+    const Node& at(std::string_view key) const;
+
+    /* null node is added for a new key */
+    Node& operator[](std::string_view key);
+    bool insert(value_type item);
+
+    bool operator==(const Dict& other) const;
+    bool operator!=(const Dict& other) const;
+
+private:
+    const_iterator LowerBound(std::string_view key) const;
+
+    std::vector<value_type> items_;
+};
+
 using Array = std::vector<Node>;
 using Number = std::variant<int, double>;
 
@@ -33,8 +66,11 @@ public:
     Node(uint32_t value);
     Node(double value);
     Node(const std::string &value);
+    Node(std::string_view value);
     Node(const Dict &value);
+    Node(Dict &&value);
     Node(const Array &value);
+    Node(Array &&value);
 
     bool operator==(const Node& other) const{
         return value_ == other.value_;
@@ -92,7 +128,7 @@ void PrintValue( const Dict &dict, std::ostream& out);
 void PrintValue(std::nullptr_t, std::ostream& out);
 void PrintValue(double value, std::ostream& out);
 void PrintValue(bool value, std::ostream& out);
-void PrintValue(const std::string &value, std::ostream& out);
+void PrintValue(std::string_view value, std::ostream& out);
 void PrintValue(int value, std::ostream &out);
 void PrintValue(uint32_t value, std::ostream &out);
 void PrintValue(const Array &array, std::ostream &out);
@@ -1,4 +1,7 @@
 #include "json_reader.h"
+#include "json_builder.h"
+#include "json_sax.h"
+#include <optional>
 #include <string>
 #include <sstream>
 
@@ -6,7 +9,10 @@ namespace TC {
 
     namespace Input{
 
-        JSONReader::JSONReader(std::istream& stream) : document_(json::Load(stream)){
+        JSONReader::JSONReader(std::istream& stream) : JSONReader(json::Load(stream)){
+        }
+
+        JSONReader::JSONReader(json::Document document) : document_(std::move(document)){
 
             if(!document_.GetRoot().IsMap())
                 throw json::ParsingError("Json::reader top level parsing error");
@@ -17,12 +23,22 @@ namespace TC {
             if(!node.IsMap())
                 throw json::ParsingError("Json::reader bottom level base parsing error");
             
-            return node.AsMap().at(std::string(name));
+            return node.AsMap().at(name);
+        }
+
+        const json::Node& JSONReader::GetRootNode(){
+
+            return document_.GetRoot();
+        }
+
+        bool JSONReader::HasRequestNodes(std::string_view name){
+
+            return document_.GetRoot().AsMap().count(name);
         }
 
         const json::Array& JSONReader::GetRequestNodesAsArray(std::string_view name){
 
-            const auto& requests_node = document_.GetRoot().AsMap().find(std::string(name))->second;
+            const auto& requests_node = GetFieldAsNode(document_.GetRoot(), name);
 
             if(!requests_node.IsArray())
                 throw json::ParsingError("Json::reader second level base parsing error");
@@ -32,7 +48,7 @@ namespace TC {
 
         const json::Dict& JSONReader::GetRequestNodesAsMap(std::string_view name){
 
-            const auto& requests_node = document_.GetRoot().AsMap().find(std::string(name))->second;
+            const auto& requests_node = GetFieldAsNode(document_.GetRoot(), name);
 
             if(!requests_node.IsMap())
                 throw json::ParsingError("Json::reader second level base parsing error");
@@ -40,16 +56,16 @@ namespace TC {
              return requests_node.AsMap();
         }
 
-        const std::string& JSONReader::GetFieldAsString(const json::Node& node, std::string_view name){
+        std::string_view JSONReader::GetFieldAsString(const json::Node& node, std::string_view name){
 
             if(!node.IsMap())
                 throw json::ParsingError("Json::reader bottom level base parsing error");
             
-            return node.AsMap().at(std::string(name)).AsString();
+            return node.AsMap().at(name).AsString();
         }
-        const std::string& JSONReader::GetFieldAsString(const json::Dict& node, std::string_view name){
+        std::string_view JSONReader::GetFieldAsString(const json::Dict& node, std::string_view name){
             
-            return node.at(std::string(name)).AsString();
+            return node.at(name).AsString();
         }
 
         bool JSONReader::GetFieldAsBool(const json::Node& node, std::string_view name){
@@ -57,7 +73,7 @@ namespace TC {
             if(!node.IsMap())
                 throw json::ParsingError("Json::reader bottom level base parsing error");
             
-            return node.AsMap().at(std::string(name)).AsBool();
+            return node.AsMap().at(name).AsBool();
         }
 
         const json::Array& JSONReader::GetFieldAsArrayNodes(const json::Node& node, std::string_view name){
@@ -65,7 +81,7 @@ namespace TC {
             if(!node.IsMap())
                 throw json::ParsingError("Json::reader bottom level base parsing error");
             
-            return node.AsMap().at(std::string(name)).AsArray();
+            return node.AsMap().at(name).AsArray();
         }
 
         double JSONReader::GetFieldAsDouble(const json::Node& node, std::string_view name){
@@ -73,7 +89,7 @@ namespace TC {
             if(!node.IsMap())
                 throw json::ParsingError("Json::reader bottom level base parsing error");
             
-            return node.AsMap().at(std::string(name)).AsDouble();
+            return node.AsMap().at(name).AsDouble();
         }
 
         const json::Dict& JSONReader::GetFieldAsMapNodes(const json::Node& node, std::string_view name){
@@ -81,7 +97,7 @@ namespace TC {
             if(!node.IsMap())
                 throw json::ParsingError("Json::reader bottom level base parsing error");
             
-            return node.AsMap().at(std::string(name)).AsMap();
+            return node.AsMap().at(name).AsMap();
         }
 
         int JSONReader::GetFieldAsInt(const json::Node& node, std::string_view name){
@@ -89,7 +105,337 @@ namespace TC {
             if(!node.IsMap())
                 throw json::ParsingError("Json::reader bottom level base parsing error");
             
-            return node.AsMap().at(std::string(name)).AsInt();
+            return node.AsMap().at(name).AsInt();
+        }
+
+        bool JSONReader::HasField(const json::Node& node, std::string_view name){
+
+            if(!node.IsMap())
+                throw json::ParsingError("Json::reader bottom level base parsing error");
+
+            return node.AsMap().count(name);
+        }
+
+        std::vector<base_request_t>* JSONReader::GetParsedBaseRequests(){
+            return nullptr;
+        }
+
+        namespace detail{
+
+            // root dict: base_requests items are filled field by field, other sections go to a Builder.
+            // Depth is the count of open containers
+            class BaseRequestsHandler : public json::SaxHandler{
+            public:
+                explicit BaseRequestsHandler(StreamingJSONReader::ParseResult& result) : result_(result){}
+
+                void Null() override { Scalar(nullptr); }
+                void Bool(bool value) override { Scalar(value); }
+                void Int(int value) override { Scalar(value); }
+                void Double(double value) override { Scalar(value); }
+
+                void String(std::string_view value) override {
+                    if(InBaseRequest() && depth_ == 3 && (field_ == "name" || field_ == "type")){
+                        if(field_ == "name"){
+                            request_.name = Intern(value);
+                        } else {
+                            request_type_ = value;
+                        }
+                    } else
+                    if(InBaseRequest() && depth_ == 4 && field_ == "stops"){
+                        request_.stops.push_back(Intern(value));
+                    } else {
+                        Scalar(std::string(value));
+                    }
+                }
+
+                void StartDict() override {
+                    if(depth_ == 0){
+                        ++depth_;
+                        return;
+                    }
+                    if(base_requests_key_ && depth_ == 1){
+                        throw json::ParsingError("Json::reader second level base parsing error");
+                    }
+                    if(section_builder_){
+                        section_builder_->StartDict();
+                    } else
+                    if(in_base_requests_ && depth_ == 2){
+                        request_ = base_request_t{};
+                        request_type_.clear();
+                    }
+                    ++depth_;
+                }
+
+                void Key(std::string_view key) override {
+                    if(depth_ == 1){
+                        base_requests_key_ = key == "base_requests";
+                        if(!base_requests_key_){
+                            section_key_ = std::string(key);
+                            section_builder_.emplace();
+                        }
+                    } else
+                    if(section_builder_){
+                        section_builder_->Key(std::string(key));
+                    } else
+                    if(InBaseRequest() && depth_ == 3){
+                        field_ = std::string(key);
+                    } else
+                    if(InBaseRequest() && depth_ == 4 && field_ == "road_distances"){
+                        distance_stop_ = Intern(key);
+                    }
+                }
+
+                void EndDict() override {
+                    --depth_;
+                    if(section_builder_){
+                        section_builder_->EndDict();
+                        FinishSectionValue();
+                    } else
+                    if(in_base_requests_ && depth_ == 2){
+                        // types other than Bus and Stop are dropped by QueueAddRequest
+                        request_.type = ParseRequestType(request_type_);
+                        result_.base_requests.push_back(std::move(request_));
+                    }
+                    if(depth_ == 2){
+                        field_.clear();
+                    }
+                }
+
+                void StartArray() override {
+                    if(depth_ == 0){
+                        throw json::ParsingError("Json::reader top level parsing error");
+                    }
+                    if(section_builder_){
+                        section_builder_->StartArray();
+                    } else
+                    if(base_requests_key_ && depth_ == 1){
+                        in_base_requests_ = true;
+                    }
+                    ++depth_;
+                }
+
+                void EndArray() override {
+                    --depth_;
+                    if(section_builder_){
+                        section_builder_->EndArray();
+                        FinishSectionValue();
+                    } else
+                    if(in_base_requests_ && depth_ == 1){
+                        in_base_requests_ = false;
+                    }
+                }
+
+            private:
+                bool InBaseRequest() const{
+                    return in_base_requests_ && depth_ >= 3;
+                }
+
+                std::string_view Intern(std::string_view value){
+                    return *result_.strings->insert(std::string(value)).first;
+                }
+
+                // scalars are checked with the same Node accessors the node reader uses
+                void Scalar(const json::Node& value){
+                    if(depth_ == 0){
+                        throw json::ParsingError("Json::reader top level parsing error");
+                    }
+                    // base_requests must be an array, as the node readers require
+                    if(base_requests_key_ && depth_ == 1){
+                        throw json::ParsingError("Json::reader second level base parsing error");
+                    }
+                    if(section_builder_){
+                        section_builder_->Value(value);
+                        FinishSectionValue();
+                        return;
+                    }
+                    if(!InBaseRequest()){
+                        return;
+                    }
+                    if(depth_ == 3){
+                        if(field_ == "name" || field_ == "type"){
+                            value.AsString();
+                        } else
+                        if(field_ == "is_roundtrip"){
+                            request_.is_roundtrip = value.AsBool();
+                        } else
+                        if(field_ == "latitude"){
+                            request_.latitude = value.AsDouble();
+                        } else
+                        if(field_ == "longitude"){
+                            request_.longitude = value.AsDouble();
+                        }
+                    } else
+                    if(depth_ == 4 && field_ == "road_distances"){
+                        request_.road_distances.insert({distance_stop_, value.AsInt()});
+                    } else
+                    if(depth_ == 4 && field_ == "stops"){
+                        value.AsString();
+                    }
+                }
+
+                // section value is complete when its builder got back to the root dict
+                void FinishSectionValue(){
+                    if(depth_ == 1){
+                        result_.sections[section_key_] = section_builder_->Build();
+                        section_builder_.reset();
+                    }
+                }
+
+                StreamingJSONReader::ParseResult& result_;
+
+                size_t depth_ = 0;
+
+                std::string section_key_;
+                std::optional<json::Builder> section_builder_;
+
+                bool base_requests_key_ = false;    // value of the current root key is base_requests
+                bool in_base_requests_ = false;     // inside base_requests array
+                base_request_t request_;
+                std::string request_type_;
+                std::string field_;
+                std::string_view distance_stop_;
+            };
+
+            inline StreamingJSONReader::ParseResult ParseStreaming(std::istream& stream){
+
+                StreamingJSONReader::ParseResult result;
+                result.strings = std::make_unique<std::unordered_set<std::string>>();
+
+                BaseRequestsHandler handler(result);
+                json::Parse(stream, handler);
+
+                return result;
+            }
+        } // namespace detail
+
+        StreamingJSONReader::StreamingJSONReader(std::istream& stream) : StreamingJSONReader(detail::ParseStreaming(stream)){
+        }
+
+        StreamingJSONReader::StreamingJSONReader(ParseResult&& result)
+            : JSONReader(json::Document(std::move(result.sections)))
+            , base_requests_(std::move(result.base_requests))
+            , strings_(std::move(result.strings)){
+        }
+
+        std::vector<base_request_t>* StreamingJSONReader::GetParsedBaseRequests(){
+            return &base_requests_;
+        }
+    
+        namespace detail{
+
+            // same errors as map lookups of the node reader
+            inline const json::ViewNode& ViewAt(const json::ViewDict& dict, std::string_view name){
+
+                if(const auto* value = json::Find(dict, name))
+                    return *value;
+
+                throw std::out_of_range("No field " + std::string(name));
+            }
+
+            inline const json::ViewNode& ViewAt(const json::ViewNode& node, std::string_view name){
+
+                if(!node.IsMap())
+                    throw json::ParsingError("Json::reader bottom level base parsing error");
+
+                return ViewAt(node.AsMap(), name);
+            }
+        } // namespace detail
+
+        ViewJSONReader::ViewJSONReader(std::istream& stream) : document_(stream){
+            CheckRoot();
+        }
+
+        ViewJSONReader::ViewJSONReader(const std::string& file_name)
+            : document_(std::make_shared<const io::MappedFile>(file_name)){
+            CheckRoot();
+        }
+
+        void ViewJSONReader::CheckRoot(){
+
+            if(!document_.GetRoot().IsMap())
+                throw json::ParsingError("Json::reader top level parsing error");
+        }
+
+        const json::ViewNode& ViewJSONReader::GetRootNode(){
+
+            return document_.GetRoot();
+        }
+
+        bool ViewJSONReader::HasRequestNodes(std::string_view name){
+
+            return json::Find(document_.GetRoot().AsMap(), name);
+        }
+
+        const json::ViewArray& ViewJSONReader::GetRequestNodesAsArray(std::string_view name){
+
+            const auto& requests_node = detail::ViewAt(document_.GetRoot(), name);
+
+            if(!requests_node.IsArray())
+                throw json::ParsingError("Json::reader second level base parsing error");
+
+            return requests_node.AsArray();
+        }
+
+        const json::ViewDict& ViewJSONReader::GetRequestNodesAsMap(std::string_view name){
+
+            const auto& requests_node = detail::ViewAt(document_.GetRoot(), name);
+
+            if(!requests_node.IsMap())
+                throw json::ParsingError("Json::reader second level base parsing error");
+
+            return requests_node.AsMap();
+        }
+
+        std::string_view ViewJSONReader::GetFieldAsString(const json::ViewNode& node, std::string_view name){
+
+            return detail::ViewAt(node, name).AsString();
+        }
+
+        std::string_view ViewJSONReader::GetFieldAsString(const json::ViewDict& node, std::string_view name){
+
+            return detail::ViewAt(node, name).AsString();
+        }
+
+        bool ViewJSONReader::GetFieldAsBool(const json::ViewNode& node, std::string_view name){
+
+            return detail::ViewAt(node, name).AsBool();
+        }
+
+        double ViewJSONReader::GetFieldAsDouble(const json::ViewNode& node, std::string_view name){
+
+            return detail::ViewAt(node, name).AsDouble();
+        }
+
+        int ViewJSONReader::GetFieldAsInt(const json::ViewNode& node, std::string_view name){
+
+            return detail::ViewAt(node, name).AsInt();
+        }
+
+        bool ViewJSONReader::HasField(const json::ViewNode& node, std::string_view name){
+
+            if(!node.IsMap())
+                throw json::ParsingError("Json::reader bottom level base parsing error");
+
+            return json::Find(node.AsMap(), name);
+        }
+
+        const json::ViewNode& ViewJSONReader::GetFieldAsNode(const json::ViewNode& node, std::string_view name){
+
+            return detail::ViewAt(node, name);
+        }
+
+        const json::ViewArray& ViewJSONReader::GetFieldAsArrayNodes(const json::ViewNode& node, std::string_view name){
+
+            return detail::ViewAt(node, name).AsArray();
+        }
+
+        const json::ViewDict& ViewJSONReader::GetFieldAsMapNodes(const json::ViewNode& node, std::string_view name){
+
+            return detail::ViewAt(node, name).AsMap();
+        }
+
+        std::vector<base_request_t>* ViewJSONReader::GetParsedBaseRequests(){
+            return nullptr;
         }
     }
 }
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "json.h"
+#include "json_view.h"
 #include "transport_catalogue.h"
 #include "domain.h"
 
+#include <memory>
+#include <unordered_set>
+
 namespace TC {
 
     namespace Input{
@@ -12,23 +16,89 @@ namespace TC {
         public:
             JSONReader(std::istream& stream);
 
+            const json::Node& GetRootNode() override;
+            bool HasRequestNodes(std::string_view name) override;
             const json::Array& GetRequestNodesAsArray(std::string_view name) override;
             const json::Dict& GetRequestNodesAsMap(std::string_view name) override;
 
-            const std::string& GetFieldAsString(const json::Node& node, std::string_view name) override;
-            const std::string& GetFieldAsString(const json::Dict& node, std::string_view name) override;
+            std::string_view GetFieldAsString(const json::Node& node, std::string_view name) override;
+            std::string_view GetFieldAsString(const json::Dict& node, std::string_view name) override;
             bool GetFieldAsBool(const json::Node& node, std::string_view name) override;
             double GetFieldAsDouble(const json::Node& node, std::string_view name) override;
             int GetFieldAsInt(const json::Node& node, std::string_view name) override;
 
+            bool HasField(const json::Node& node, std::string_view name) override;
+
             const json::Node& GetFieldAsNode(const json::Node& node, std::string_view name) override;
 
             const json::Array& GetFieldAsArrayNodes(const json::Node& node, std::string_view name) override;
             const json::Dict& GetFieldAsMapNodes(const json::Node& node, std::string_view name) override;
 
+            std::vector<base_request_t>* GetParsedBaseRequests() override;
+
+        protected:
+            explicit JSONReader(json::Document document);
+
         private:
             json::Document document_;
         };
 
+        // make_base reader built on json::Parse: base_requests go into base_request_t while parsing,
+        // only the other (small) sections become nodes
+        class StreamingJSONReader : public JSONReader{
+        public:
+            StreamingJSONReader(std::istream& stream);
+
+            std::vector<base_request_t>* GetParsedBaseRequests() override;
+
+            // what the parser collects, names of base_requests point into strings
+            struct ParseResult{
+                json::Dict sections;
+                std::vector<base_request_t> base_requests;
+                std::unique_ptr<std::unordered_set<std::string>> strings;
+            };
+
+        private:
+            explicit StreamingJSONReader(ParseResult&& result);
+
+            std::vector<base_request_t> base_requests_;
+            std::unique_ptr<std::unordered_set<std::string>> strings_;
+        };
+
+        // reader over json::ViewDocument: the input stays in one buffer and strings of
+        // base_request_t are slices of it, so nothing is copied before the catalogue
+        class ViewJSONReader : public Reader<json::ViewArray, json::ViewDict, json::ViewNode>{
+        public:
+            /* reads the stream at once */
+            explicit ViewJSONReader(std::istream& stream);
+            /* maps the file */
+            explicit ViewJSONReader(const std::string& file_name);
+
+            const json::ViewNode& GetRootNode() override;
+            bool HasRequestNodes(std::string_view name) override;
+            const json::ViewArray& GetRequestNodesAsArray(std::string_view name) override;
+            const json::ViewDict& GetRequestNodesAsMap(std::string_view name) override;
+
+            std::string_view GetFieldAsString(const json::ViewNode& node, std::string_view name) override;
+            std::string_view GetFieldAsString(const json::ViewDict& node, std::string_view name) override;
+            bool GetFieldAsBool(const json::ViewNode& node, std::string_view name) override;
+            double GetFieldAsDouble(const json::ViewNode& node, std::string_view name) override;
+            int GetFieldAsInt(const json::ViewNode& node, std::string_view name) override;
+
+            bool HasField(const json::ViewNode& node, std::string_view name) override;
+
+            const json::ViewNode& GetFieldAsNode(const json::ViewNode& node, std::string_view name) override;
+
+            const json::ViewArray& GetFieldAsArrayNodes(const json::ViewNode& node, std::string_view name) override;
+            const json::ViewDict& GetFieldAsMapNodes(const json::ViewNode& node, std::string_view name) override;
+
+            std::vector<base_request_t>* GetParsedBaseRequests() override;
+
+        private:
+            void CheckRoot();
+
+            json::ViewDocument document_;
+        };
+
     } // namespace Input
 } // namespace TC
\ No newline at end of file
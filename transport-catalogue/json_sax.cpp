@@ -0,0 +1,271 @@
+#include "json_sax.h"
+
+#include <cctype>
+#include <charconv>
+#include <string>
+
+using namespace std;
+
+namespace json {
+
+namespace {
+
+// reads straight from the stream buffer, strings are collected into one reused buffer
+class SaxParser {
+public:
+    SaxParser(istream& input, SaxHandler& handler)
+        : buffer_(*input.rdbuf())
+        , handler_(handler){
+    }
+
+    void ParseValue();
+
+private:
+    static constexpr int END = char_traits<char>::eof();
+
+    int Peek() {
+        return buffer_.sgetc();
+    }
+
+    int Get() {
+        return buffer_.sbumpc();
+    }
+
+    void SkipSpaces();
+    void Expect(char expected, const char* error);
+
+    void ParseDict();
+    void ParseArray();
+    void ParseString();
+    void ParseNumber();
+    void ParseLiteral(string_view literal);
+
+    streambuf& buffer_;
+    SaxHandler& handler_;
+    string string_;
+};
+
+void SaxParser::SkipSpaces() {
+    for (int c = Peek(); c == ' ' || c == '\t' || c == '\n' || c == '\r'; c = Peek()) {
+        Get();
+    }
+}
+
+void SaxParser::Expect(char expected, const char* error) {
+    SkipSpaces();
+    if (Get() != expected) {
+        throw ParsingError(error);
+    }
+}
+
+void SaxParser::ParseValue() {
+    SkipSpaces();
+
+    switch (Peek()) {
+        case '{':
+            ParseDict();
+            break;
+        case '[':
+            ParseArray();
+            break;
+        case '"':
+            ParseString();
+            handler_.String(string_);
+            break;
+        case 't':
+            ParseLiteral("true"sv);
+            handler_.Bool(true);
+            break;
+        case 'f':
+            ParseLiteral("false"sv);
+            handler_.Bool(false);
+            break;
+        case 'n':
+            ParseLiteral("null"sv);
+            handler_.Null();
+            break;
+        case END:
+            throw ParsingError("Unexpected end of input"s);
+        default:
+            ParseNumber();
+    }
+}
+
+void SaxParser::ParseDict() {
+    Get();
+    handler_.StartDict();
+
+    SkipSpaces();
+    if (Peek() == '}') {
+        Get();
+        handler_.EndDict();
+        return;
+    }
+
+    while (true) {
+        SkipSpaces();
+        if (Peek() != '"') {
+            throw ParsingError("Dict error"s);
+        }
+        ParseString();
+        handler_.Key(string_);
+
+        Expect(':', "Dict error");
+        ParseValue();
+
+        SkipSpaces();
+        const int c = Get();
+        if (c == '}') {
+            break;
+        }
+        if (c != ',') {
+            throw ParsingError("Dict error"s);
+        }
+    }
+
+    handler_.EndDict();
+}
+
+void SaxParser::ParseArray() {
+    Get();
+    handler_.StartArray();
+
+    SkipSpaces();
+    if (Peek() == ']') {
+        Get();
+        handler_.EndArray();
+        return;
+    }
+
+    while (true) {
+        ParseValue();
+
+        SkipSpaces();
+        const int c = Get();
+        if (c == ']') {
+            break;
+        }
+        if (c != ',') {
+            throw ParsingError("Array error"s);
+        }
+    }
+
+    handler_.EndArray();
+}
+
+// same escapes as Load
+void SaxParser::ParseString() {
+    Get();
+    string_.clear();
+
+    while (true) {
+        const int c = Get();
+        if (c == END) {
+            throw ParsingError("String parsing error"s);
+        }
+        if (c == '"') {
+            return;
+        }
+        if (c == '\n' || c == '\r') {
+            throw ParsingError("Unexpected end of line"s);
+        }
+        if (c != '\\') {
+            string_.push_back(static_cast<char>(c));
+            continue;
+        }
+
+        switch (const int escaped = Get(); escaped) {
+            case 'n':
+                string_.push_back('\n');
+                break;
+            case 't':
+                string_.push_back('\t');
+                break;
+            case 'r':
+                string_.push_back('\r');
+                break;
+            case '"':
+                string_.push_back('"');
+                break;
+            case '\\':
+                string_.push_back('\\');
+                break;
+            case END:
+                throw ParsingError("String parsing error"s);
+            default:
+                throw ParsingError("Unrecognized escape sequence \\"s + static_cast<char>(escaped));
+        }
+    }
+}
+
+// same grammar and int/double choice as Load
+void SaxParser::ParseNumber() {
+    string number;
+
+    auto read_digits = [&] {
+        if (!isdigit(Peek())) {
+            throw ParsingError("A digit is expected"s);
+        }
+        while (isdigit(Peek())) {
+            number.push_back(static_cast<char>(Get()));
+        }
+    };
+
+    if (Peek() == '-') {
+        number.push_back(static_cast<char>(Get()));
+    }
+    if (Peek() == '0') {
+        number.push_back(static_cast<char>(Get()));
+    } else {
+        read_digits();
+    }
+
+    bool is_int = true;
+    if (Peek() == '.') {
+        number.push_back(static_cast<char>(Get()));
+        read_digits();
+        is_int = false;
+    }
+    if (int c = Peek(); c == 'e' || c == 'E') {
+        number.push_back(static_cast<char>(Get()));
+        if (c = Peek(); c == '+' || c == '-') {
+            number.push_back(static_cast<char>(Get()));
+        }
+        read_digits();
+        is_int = false;
+    }
+
+    const char* begin = number.data();
+    const char* end = begin + number.size();
+
+    if (is_int) {
+        int value = 0;
+        if (from_chars(begin, end, value).ec == errc{}) {
+            handler_.Int(value);
+            return;
+        }
+        // too big for int, goes as double
+    }
+
+    double value = 0;
+    if (from_chars(begin, end, value).ec != errc{}) {
+        throw ParsingError("Failed to convert "s + number + " to number"s);
+    }
+    handler_.Double(value);
+}
+
+void SaxParser::ParseLiteral(string_view literal) {
+    for (const char expected : literal) {
+        if (Get() != expected) {
+            throw ParsingError("Unexpected literal"s);
+        }
+    }
+}
+
+}  // namespace
+
+void Parse(istream& input, SaxHandler& handler) {
+    SaxParser(input, handler).ParseValue();
+}
+
+}  // namespace json
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "json.h"
+
+#include <iostream>
+#include <string_view>
+
+namespace json {
+
+// events of Parse in document order, every value is either one scalar call
+// or Start..End pair around its items. Views are only valid during the call
+class SaxHandler {
+public:
+    virtual void Null() = 0;
+    virtual void Bool(bool value) = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    virtual void String(std::string_view value) = 0;
+
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+
+    virtual ~SaxHandler() {};
+};
+
+/* reads one value from input and reports it to handler without building nodes,
+   throws ParsingError on malformed input */
+void Parse(std::istream& input, SaxHandler& handler);
+
+}  // namespace json
@@ -0,0 +1,254 @@
+#include "json_scan.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define JSON_SCAN_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace json {
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = 64;
+// scanned per call, keeps tokens of a chunk in cache until the second pass takes them
+constexpr size_t CHUNK_SIZE = 1024 * BLOCK_SIZE;
+
+// one bit per byte of a block
+struct BlockMasks {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t structural = 0;
+    uint64_t line_break = 0;
+    uint64_t whitespace = 0;
+    uint64_t non_ascii = 0;
+};
+
+// the only one on other architectures
+[[maybe_unused]] BlockMasks ClassifyScalar(const char* block) {
+    BlockMasks masks;
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        const uint64_t bit = uint64_t{1} << i;
+        switch (block[i]) {
+            case '"':
+                masks.quote |= bit;
+                break;
+            case '\\':
+                masks.backslash |= bit;
+                break;
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                masks.structural |= bit;
+                break;
+            case '\n': case '\r':
+                masks.line_break |= bit;
+                masks.whitespace |= bit;
+                break;
+            case ' ': case '\t':
+                masks.whitespace |= bit;
+                break;
+            default:
+                if (static_cast<unsigned char>(block[i]) >= 0x80) {
+                    masks.non_ascii |= bit;
+                }
+        }
+    }
+    return masks;
+}
+
+#ifdef JSON_SCAN_X86
+
+BlockMasks ClassifySse2(const char* block) {
+    BlockMasks masks;
+    for (size_t i = 0; i < BLOCK_SIZE; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        auto mask = [&bytes](char c) {
+            return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c)))));
+        };
+
+        masks.quote |= mask('"') << i;
+        masks.backslash |= mask('\\') << i;
+        masks.structural |= (mask('{') | mask('}') | mask('[') | mask(']') | mask(':') | mask(',')) << i;
+        masks.line_break |= (mask('\n') | mask('\r')) << i;
+        masks.whitespace |= (mask('\n') | mask('\r') | mask(' ') | mask('\t')) << i;
+        masks.non_ascii |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(bytes))) << i;
+    }
+    return masks;
+}
+
+__attribute__((target("avx2")))
+inline uint64_t Avx2Mask(__m256i bytes, char c) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c))));
+}
+
+__attribute__((target("avx2")))
+BlockMasks ClassifyAvx2(const char* block) {
+    BlockMasks masks;
+    for (size_t i = 0; i < BLOCK_SIZE; i += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+
+        masks.quote |= Avx2Mask(bytes, '"') << i;
+        masks.backslash |= Avx2Mask(bytes, '\\') << i;
+        masks.structural |= (Avx2Mask(bytes, '{') | Avx2Mask(bytes, '}') | Avx2Mask(bytes, '[')
+                             | Avx2Mask(bytes, ']') | Avx2Mask(bytes, ':') | Avx2Mask(bytes, ',')) << i;
+        const uint64_t line_break = Avx2Mask(bytes, '\n') | Avx2Mask(bytes, '\r');
+        masks.line_break |= line_break << i;
+        masks.whitespace |= (line_break | Avx2Mask(bytes, ' ') | Avx2Mask(bytes, '\t')) << i;
+        masks.non_ascii |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(bytes))) << i;
+    }
+    return masks;
+}
+
+#endif
+
+using Classifier = BlockMasks (*)(const char*);
+
+// chosen once for the running CPU, SSE2 is always there on x86-64
+Classifier SelectClassifier() {
+#ifdef JSON_SCAN_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return ClassifyAvx2;
+    }
+    return ClassifySse2;
+#else
+    return ClassifyScalar;
+#endif
+}
+
+// bit i is the xor of bits 0..i, so bits between an opening and a closing quote are set
+uint64_t PrefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// checks the non-ASCII run starting at pos, returns where the run ends
+size_t ValidateUtf8(const unsigned char* input, size_t pos, size_t size) {
+    while (pos < size && input[pos] >= 0x80) {
+        const unsigned char lead = input[pos];
+
+        size_t length = 0;
+        unsigned char second_min = 0x80;
+        unsigned char second_max = 0xBF;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            second_min = lead == 0xE0 ? 0xA0 : 0x80;   // overlong
+            second_max = lead == 0xED ? 0x9F : 0xBF;   // surrogates
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            second_min = lead == 0xF0 ? 0x90 : 0x80;   // overlong
+            second_max = lead == 0xF4 ? 0x8F : 0xBF;   // above U+10FFFF
+        } else {
+            throw ParsingError("Invalid UTF-8");
+        }
+
+        if (size - pos < length || input[pos + 1] < second_min || input[pos + 1] > second_max) {
+            throw ParsingError("Invalid UTF-8");
+        }
+        for (size_t i = 2; i < length; ++i) {
+            if (input[pos + i] < 0x80 || input[pos + i] > 0xBF) {
+                throw ParsingError("Invalid UTF-8");
+            }
+        }
+        pos += length;
+    }
+    return pos;
+}
+
+}  // namespace
+
+TokenScanner::TokenScanner(string_view input) : input_(input) {
+}
+
+bool TokenScanner::ScanChunk(vector<const char*>& tokens) {
+    static const Classifier classify = SelectClassifier();
+
+    if (offset_ >= input_.size()) {
+        return false;
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(input_.data());
+    const size_t chunk_end = min(input_.size(), offset_ + CHUNK_SIZE);
+
+    // a block has 64 tokens at most
+    tokens.clear();
+    tokens.reserve(CHUNK_SIZE);
+
+    for (; offset_ < chunk_end; offset_ += BLOCK_SIZE) {
+
+        BlockMasks masks;
+        if (input_.size() - offset_ >= BLOCK_SIZE) {
+            masks = classify(input_.data() + offset_);
+        } else {
+            char tail[BLOCK_SIZE];
+            memset(tail, ' ', BLOCK_SIZE);
+            memcpy(tail, input_.data() + offset_, input_.size() - offset_);
+            masks = classify(tail);
+        }
+
+        // a backslash escapes the next char, unless it is escaped itself.
+        // Backslashes are rare, so they are walked one by one
+        uint64_t escaped = 0;
+        uint64_t backslash = masks.backslash;
+        if (escaped_carry_) {
+            escaped |= 1;
+            backslash &= ~uint64_t{1};
+        }
+        escaped_carry_ = false;
+        while (backslash) {
+            const uint64_t bit = backslash & (~backslash + 1);
+            const uint64_t next = bit << 1;
+            if (next) {
+                escaped |= next;
+                backslash &= ~next;
+            } else {
+                escaped_carry_ = true;
+            }
+            backslash &= ~bit;
+        }
+
+        const uint64_t quotes = masks.quote & ~escaped;
+        const uint64_t string_bits = PrefixXor(quotes) ^ in_string_;
+        in_string_ = static_cast<uint64_t>(static_cast<int64_t>(string_bits) >> 63);
+
+        if (masks.line_break & string_bits) {
+            throw ParsingError("Unexpected end of line");
+        }
+
+        // validated runs may cover the rest of the block
+        for (uint64_t bits = masks.non_ascii; bits;) {
+            const size_t pos = offset_ + __builtin_ctzll(bits);
+            if (pos >= utf8_checked_) {
+                utf8_checked_ = ValidateUtf8(bytes, pos, input_.size());
+            }
+            const size_t checked_in_block = utf8_checked_ - offset_;
+            bits = checked_in_block >= BLOCK_SIZE ? 0 : bits & (~uint64_t{0} << checked_in_block);
+        }
+
+        // numbers and literals are runs of other chars outside strings, their first chars are tokens too
+        const uint64_t scalar = ~(masks.structural | masks.whitespace | quotes | string_bits);
+        const uint64_t scalar_starts = scalar & ~((scalar << 1) | scalar_carry_);
+        scalar_carry_ = scalar >> 63;
+
+        for (uint64_t bits = (masks.structural & ~string_bits) | quotes | scalar_starts; bits; bits &= bits - 1) {
+            tokens.push_back(input_.data() + offset_ + __builtin_ctzll(bits));
+        }
+    }
+
+    if (offset_ >= input_.size() && in_string_) {
+        throw ParsingError("String parsing error");
+    }
+    return true;
+}
+
+}  // namespace json
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+/* first pass of ViewDocument parsing: finds every token in input order, that is
+   structural characters ({}[]:,) outside strings, quotes opening and closing strings
+   and first characters of numbers and literals. Whitespace between them is never looked at again.
+   Input is scanned 64 bytes at a time with the widest vector instructions the CPU has,
+   a chunk of blocks per call, so tokens of the whole input are never kept at once.
+   Throws ParsingError on invalid UTF-8, line breaks inside strings and unterminated strings */
+class TokenScanner {
+public:
+    explicit TokenScanner(std::string_view input);
+
+    /* replaces tokens with the starts of tokens of the next chunk, which may have none.
+       False if the input is over */
+    bool ScanChunk(std::vector<const char*>& tokens);
+
+private:
+    std::string_view input_;
+    size_t offset_ = 0;
+
+    uint64_t in_string_ = 0;        // all ones if the previous block ended inside a string
+    bool escaped_carry_ = false;    // the previous block ended with an escaping backslash
+    uint64_t scalar_carry_ = 0;     // 1 if the previous block ended inside a number or a literal
+    size_t utf8_checked_ = 0;       // input before this offset is known to be valid
+};
+
+}  // namespace json
@@ -0,0 +1,417 @@
+#include "json_view.h"
+#include "json_scan.h"
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <new>
+
+using namespace std;
+
+namespace json {
+
+namespace {
+
+// same escapes as Load
+string DecodeEscapes(string_view raw) {
+    string result;
+    result.reserve(raw.size());
+
+    for (size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] != '\\') {
+            result.push_back(raw[i]);
+            continue;
+        }
+        switch (raw[++i]) {
+            case 'n':
+                result.push_back('\n');
+                break;
+            case 't':
+                result.push_back('\t');
+                break;
+            case 'r':
+                result.push_back('\r');
+                break;
+            default:    // '"' or '\\', checked by the parser
+                result.push_back(raw[i]);
+        }
+    }
+    return result;
+}
+
+// first arena block is about the input size, the tree takes a few times more
+size_t GetArenaBlockSize(size_t input_size) {
+    return max<size_t>(input_size, 4096);
+}
+
+// second pass: recursive descent over the tokens found by TokenScanner, same grammar
+// as json::Parse. Neither whitespace nor strings are scanned again
+class ViewParser {
+public:
+    ViewParser(string_view input, const ViewDocument& document,
+               pmr::memory_resource& arena, deque<string>& decoded_keys)
+        : end_(input.data() + input.size())
+        , scanner_(input)
+        , document_(document)
+        , arena_(arena)
+        , decoded_keys_(decoded_keys){
+    }
+
+    ViewNode ParseValue();
+
+private:
+    // first char of the next token, scans further chunks until there is one
+    int Peek() {
+        while (next_ == tokens_.size()) {
+            if (!scanner_.ScanChunk(tokens_)) {
+                return char_traits<char>::eof();
+            }
+            next_ = 0;
+        }
+        return static_cast<unsigned char>(*tokens_[next_]);
+    }
+
+    // start of the next token, which becomes the current one
+    const char* Next() {
+        if (Peek() == char_traits<char>::eof()) {
+            throw ParsingError("Unexpected end of input"s);
+        }
+        current_ = tokens_[next_++];
+        return current_;
+    }
+
+    ViewNode ParseDict();
+    ViewNode ParseArray();
+    ViewNode::RawString ParseString();
+    ViewNode ParseNumber();
+    void ParseLiteral(string_view literal);
+
+    // the rest of a number or a literal run would be garbage
+    void CheckScalarEnd(const char* pos) const;
+
+    const char* end_;
+    TokenScanner scanner_;
+    vector<const char*> tokens_;
+    size_t next_ = 0;
+    const char* current_ = nullptr;
+    const ViewDocument& document_;
+    pmr::memory_resource& arena_;
+    deque<string>& decoded_keys_;
+
+    // items of unfinished containers, a finished one is moved to the arena at its exact size
+    vector<ViewNode> array_items_;
+    vector<pair<string_view, ViewNode>> dict_items_;
+};
+
+ViewNode ViewParser::ParseValue() {
+    switch (Peek()) {
+        case '{':
+            return ParseDict();
+        case '[':
+            return ParseArray();
+        case '"':
+            return ViewNode(ParseString());
+        case 't':
+            ParseLiteral("true"sv);
+            return ViewNode(true);
+        case 'f':
+            ParseLiteral("false"sv);
+            return ViewNode(false);
+        case 'n':
+            ParseLiteral("null"sv);
+            return ViewNode(nullptr);
+        case char_traits<char>::eof():
+            throw ParsingError("Unexpected end of input"s);
+        default:
+            return ParseNumber();
+    }
+}
+
+ViewNode ViewParser::ParseDict() {
+    Next();
+    const size_t first_item = dict_items_.size();
+
+    if (Peek() == '}') {
+        Next();
+        return ViewNode(ViewDict(&arena_));
+    }
+
+    while (true) {
+        if (Peek() != '"') {
+            throw ParsingError("Dict error"s);
+        }
+        const auto key = ParseString();
+
+        if (Peek() != ':') {
+            throw ParsingError("Dict error"s);
+        }
+        Next();
+
+        const string_view name = key.escaped_in ? decoded_keys_.emplace_back(DecodeEscapes(key.raw)) : key.raw;
+        dict_items_.emplace_back(name, ParseValue());
+
+        const int c = Peek();
+        if (c != '}' && c != ',') {
+            throw ParsingError("Dict error"s);
+        }
+        Next();
+        if (c == '}') {
+            break;
+        }
+    }
+
+    const auto items = dict_items_.begin() + first_item;
+    ViewDict result(make_move_iterator(items), make_move_iterator(dict_items_.end()), &arena_);
+    dict_items_.erase(items, dict_items_.end());
+
+    return ViewNode(move(result));
+}
+
+ViewNode ViewParser::ParseArray() {
+    Next();
+    const size_t first_item = array_items_.size();
+
+    if (Peek() == ']') {
+        Next();
+        return ViewNode(ViewArray(&arena_));
+    }
+
+    while (true) {
+        array_items_.push_back(ParseValue());
+
+        const int c = Peek();
+        if (c != ']' && c != ',') {
+            throw ParsingError("Array error"s);
+        }
+        Next();
+        if (c == ']') {
+            break;
+        }
+    }
+
+    const auto items = array_items_.begin() + first_item;
+    ViewArray result(make_move_iterator(items), make_move_iterator(array_items_.end()), &arena_);
+    array_items_.erase(items, array_items_.end());
+
+    return ViewNode(move(result));
+}
+
+// the closing quote is the next token and line breaks are checked by the first pass,
+// escapes are only checked here, decoding is up to the document
+ViewNode::RawString ViewParser::ParseString() {
+    const char* begin = Next() + 1;
+    const char* end = Next();
+    const string_view raw(begin, end - begin);
+
+    const size_t first_escape = raw.find('\\');
+    for (size_t i = first_escape; i < raw.size(); ++i) {
+        if (raw[i] != '\\') {
+            continue;
+        }
+        const char e = raw[++i];
+        if (e != 'n' && e != 't' && e != 'r' && e != '"' && e != '\\') {
+            throw ParsingError("Unrecognized escape sequence \\"s + e);
+        }
+    }
+
+    return ViewNode::RawString{raw, first_escape != string_view::npos ? &document_ : nullptr};
+}
+
+// same grammar and int/double choice as Load
+ViewNode ViewParser::ParseNumber() {
+    const char* begin = Next();
+    const char* pos = begin;
+
+    auto peek = [&] {
+        return pos == end_ ? char_traits<char>::eof() : static_cast<unsigned char>(*pos);
+    };
+    auto is_digit = [&] {
+        return pos != end_ && *pos >= '0' && *pos <= '9';
+    };
+    auto read_digits = [&] {
+        if (!is_digit()) {
+            throw ParsingError("A digit is expected"s);
+        }
+        while (is_digit()) {
+            ++pos;
+        }
+    };
+
+    if (peek() == '-') {
+        ++pos;
+    }
+    if (peek() == '0') {
+        ++pos;
+    } else {
+        read_digits();
+    }
+
+    bool is_int = true;
+    if (peek() == '.') {
+        ++pos;
+        read_digits();
+        is_int = false;
+    }
+    if (int c = peek(); c == 'e' || c == 'E') {
+        ++pos;
+        if (c = peek(); c == '+' || c == '-') {
+            ++pos;
+        }
+        read_digits();
+        is_int = false;
+    }
+    CheckScalarEnd(pos);
+
+    if (is_int) {
+        int value = 0;
+        if (from_chars(begin, pos, value).ec == errc{}) {
+            return ViewNode(value);
+        }
+        // too big for int, goes as double
+    }
+
+    double value = 0;
+    if (const auto result = from_chars(begin, pos, value); result.ec != errc{}) {
+        throw ParsingError("Failed to convert "s + string(begin, pos) + " to number"s);
+    }
+    return ViewNode(value);
+}
+
+void ViewParser::ParseLiteral(string_view literal) {
+    const char* pos = Next();
+    if (static_cast<size_t>(end_ - pos) < literal.size() || string_view(pos, literal.size()) != literal) {
+        throw ParsingError("Unexpected literal"s);
+    }
+    CheckScalarEnd(pos + literal.size());
+}
+
+void ViewParser::CheckScalarEnd(const char* pos) const {
+    if (pos != end_ && " \t\n\r{}[]:,"sv.find(*pos) == string_view::npos) {
+        throw ParsingError("Unexpected character after "s + string(current_, pos + 1));
+    }
+}
+
+}  // namespace
+
+ViewNode::ViewNode(nullptr_t value) : value_(value) {}
+ViewNode::ViewNode(bool value) : value_(value) {}
+ViewNode::ViewNode(int value) : value_(value) {}
+ViewNode::ViewNode(double value) : value_(value) {}
+ViewNode::ViewNode(RawString value) : value_(value) {}
+ViewNode::ViewNode(ViewArray value) : value_(move(value)) {}
+ViewNode::ViewNode(ViewDict value) : value_(move(value)) {}
+
+bool ViewNode::IsInt() const {
+    return holds_alternative<int>(value_);
+}
+bool ViewNode::IsDouble() const {
+    return IsInt() || IsPureDouble();
+}
+bool ViewNode::IsPureDouble() const {
+    return holds_alternative<double>(value_);
+}
+bool ViewNode::IsBool() const {
+    return holds_alternative<bool>(value_);
+}
+bool ViewNode::IsString() const {
+    return holds_alternative<RawString>(value_);
+}
+bool ViewNode::IsNull() const {
+    return holds_alternative<nullptr_t>(value_);
+}
+bool ViewNode::IsArray() const {
+    return holds_alternative<ViewArray>(value_);
+}
+bool ViewNode::IsMap() const {
+    return holds_alternative<ViewDict>(value_);
+}
+
+int ViewNode::AsInt() const {
+    if (IsInt()) {
+        return get<int>(value_);
+    }
+    throw logic_error("Not an Int");
+}
+
+bool ViewNode::AsBool() const {
+    if (IsBool()) {
+        return get<bool>(value_);
+    }
+    throw logic_error("Not a bool");
+}
+
+double ViewNode::AsDouble() const {
+    if (IsInt()) {
+        return static_cast<double>(get<int>(value_));
+    }
+    if (IsPureDouble()) {
+        return get<double>(value_);
+    }
+    throw logic_error("Not a number");
+}
+
+string_view ViewNode::AsString() const {
+    if (!IsString()) {
+        throw logic_error("Not a string");
+    }
+    const auto& value = get<RawString>(value_);
+    return value.escaped_in ? value.escaped_in->Decode(value.raw) : value.raw;
+}
+
+const ViewArray& ViewNode::AsArray() const {
+    if (IsArray()) {
+        return get<ViewArray>(value_);
+    }
+    throw logic_error("Not an array");
+}
+
+const ViewDict& ViewNode::AsMap() const {
+    if (IsMap()) {
+        return get<ViewDict>(value_);
+    }
+    throw logic_error("Not a map");
+}
+
+const ViewNode* Find(const ViewDict& dict, string_view key) {
+    for (const auto& [name, value] : dict) {
+        if (name == key) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
+
+ViewDocument::ViewDocument(istream& input)
+    : buffer_(istreambuf_iterator<char>(input), istreambuf_iterator<char>())
+    , input_(buffer_)
+    , arena_(GetArenaBlockSize(input_.size())) {
+    Parse();
+}
+
+ViewDocument::ViewDocument(shared_ptr<const io::MappedFile> file)
+    : file_(move(file))
+    , input_(file_->GetData(), file_->GetSize())
+    , arena_(GetArenaBlockSize(input_.size())) {
+    Parse();
+}
+
+void ViewDocument::Parse() {
+    void* root = arena_.allocate(sizeof(ViewNode), alignof(ViewNode));
+    root_ = new (root) ViewNode(ViewParser(input_, *this, arena_, decoded_keys_).ParseValue());
+}
+
+const ViewNode& ViewDocument::GetRoot() const {
+    return *root_;
+}
+
+string_view ViewDocument::Decode(string_view raw) const {
+    lock_guard guard(decoded_mutex_);
+
+    auto it = decoded_.find(raw.data());
+    if (it == decoded_.end()) {
+        it = decoded_.emplace(raw.data(), DecodeEscapes(raw)).first;
+    }
+    return it->second;
+}
+
+}  // namespace json
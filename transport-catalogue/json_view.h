@@ -0,0 +1,105 @@
+#pragma once
+
+#include "json.h"
+#include "mapped_file.h"
+
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace json {
+
+class ViewNode;
+class ViewDocument;
+
+// containers of a document live in its arena, copies made outside of it use the default resource
+using ViewArray = std::pmr::vector<ViewNode>;
+using ViewDict = std::pmr::vector<std::pair<std::string_view, ViewNode>>;   // keys in document order
+
+// value of ViewDocument: strings and keys are slices of the document buffer,
+// valid as long as the document is
+class ViewNode {
+public:
+    // string as it is between the quotes, the document decodes it on request if it has escapes
+    struct RawString {
+        std::string_view raw;
+        const ViewDocument* escaped_in = nullptr;  // set for strings with escapes only
+    };
+
+    using Value = std::variant<std::nullptr_t, ViewArray, ViewDict, bool, int, double, RawString>;
+
+    ViewNode() = default;
+
+    ViewNode(std::nullptr_t value);
+    ViewNode(bool value);
+    ViewNode(int value);
+    ViewNode(double value);
+    ViewNode(RawString value);
+    ViewNode(ViewArray value);
+    ViewNode(ViewDict value);
+
+    bool IsInt() const;
+    bool IsDouble() const;      // int or double
+    bool IsPureDouble() const;
+    bool IsBool() const;
+    bool IsString() const;
+    bool IsNull() const;
+    bool IsArray() const;
+    bool IsMap() const;
+
+    int AsInt() const;
+    bool AsBool() const;
+    double AsDouble() const;
+    std::string_view AsString() const;
+    const ViewArray& AsArray() const;
+    const ViewDict& AsMap() const;
+
+private:
+    Value value_;
+};
+
+/* first value with the key, nullptr if there is none */
+const ViewNode* Find(const ViewDict& dict, std::string_view key);
+
+// whole input kept in one buffer, either read at once from a stream or a mapped file.
+// Nodes point into the document, so it is neither copied nor moved.
+// The tree is allocated in a monotonic arena and dropped with it, node destructors never run
+class ViewDocument {
+public:
+    /* both throw ParsingError on malformed input */
+    explicit ViewDocument(std::istream& input);
+    explicit ViewDocument(std::shared_ptr<const io::MappedFile> file);
+
+    ViewDocument(const ViewDocument&) = delete;
+    ViewDocument& operator=(const ViewDocument&) = delete;
+
+    const ViewNode& GetRoot() const;
+
+    /* raw string with escapes decoded, once per string on the first request.
+       Safe to call concurrently */
+    std::string_view Decode(std::string_view raw) const;
+
+private:
+    void Parse();
+
+    std::string buffer_;                            // input read from a stream
+    std::shared_ptr<const io::MappedFile> file_;    // or mapped one
+    std::string_view input_;
+
+    std::pmr::monotonic_buffer_resource arena_;
+    const ViewNode* root_ = nullptr;
+    std::deque<std::string> decoded_keys_;          // keys with escapes are decoded while parsing, lookups need them
+
+    mutable std::mutex decoded_mutex_;
+    mutable std::unordered_map<const char*, std::string> decoded_;  // by raw string start
+};
+
+}  // namespace json
@@ -0,0 +1,181 @@
+#include "json_writer.h"
+
+#include <stdexcept>
+
+namespace json {
+
+    Writer::Writer() : output_(buffer_){
+    }
+
+    Writer::Writer(std::ostream& output) : output_(output){
+    }
+
+    void Writer::StartValue(){
+
+        if(finished_)
+            throw std::logic_error("json is finished");
+
+        if(levels_.empty())
+            return;
+
+        auto& level = levels_.back();
+
+        if(level.is_dict){
+            if(!level.has_key)
+                throw std::logic_error("json no key on value");
+            level.has_key = false;
+        } else {
+            if(!level.is_empty)
+                output_ << ',';
+            level.is_empty = false;
+        }
+    }
+
+    void Writer::EndValue(){
+        if(levels_.empty())
+            finished_ = true;
+    }
+
+    Writer& Writer::Value(std::nullptr_t value){
+        StartValue();
+        PrintValue(value, output_);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(bool value){
+        StartValue();
+        PrintValue(value, output_);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(int value){
+        StartValue();
+        PrintValue(value, output_);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(uint32_t value){
+        StartValue();
+        PrintValue(value, output_);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(double value){
+        StartValue();
+        PrintValue(value, output_);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(std::string_view value){
+        StartValue();
+        PrintValue(value, output_);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(const std::string& value){
+        return Value(std::string_view(value));
+    }
+
+    Writer& Writer::Value(const char* value){
+        return Value(std::string_view(value));
+    }
+
+    Writer& Writer::Value(const RawJson& value){
+        StartValue();
+        output_ << value.text;
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(const std::vector<RawJson>& value){
+        StartArray();
+        for(const auto& item : value){
+            Value(item);
+        }
+        return EndArray();
+    }
+
+    Writer& Writer::StartDict(){
+        StartValue();
+        levels_.push_back(Level{true});
+        output_ << "\n{ \n";
+        return *this;
+    }
+
+    Writer& Writer::Key(std::string_view key){
+
+        if(finished_ || levels_.empty() || !levels_.back().is_dict)
+            throw std::logic_error("json key on the wrong type");
+
+        auto& level = levels_.back();
+
+        if(level.has_key)
+            throw std::logic_error("json key unused");
+
+        if(!level.is_empty)
+            output_ << ",\n";
+
+        output_ << '\"' << key << "\": ";
+
+        level.is_empty = false;
+        level.has_key = true;
+        return *this;
+    }
+
+    Writer& Writer::EndDict(){
+
+        if(levels_.empty() || !levels_.back().is_dict || levels_.back().has_key)
+            throw std::logic_error("json wrong end of container");
+
+        levels_.pop_back();
+        output_ << "\n}";
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::StartArray(){
+        StartValue();
+        levels_.push_back(Level{false});
+        output_ << '[';
+        return *this;
+    }
+
+    Writer& Writer::EndArray(){
+
+        if(levels_.empty() || levels_.back().is_dict)
+            throw std::logic_error("json wrong end of container");
+
+        levels_.pop_back();
+        output_ << ']';
+        EndValue();
+        return *this;
+    }
+
+    RawJson Writer::Build(){
+
+        if(!finished_)
+            throw std::logic_error("json not finished");
+
+        if(&output_ != &buffer_)
+            throw std::logic_error("json is written to output");
+
+        return RawJson{buffer_.str()};
+    }
+
+    void Writer::Print(std::ostream& output){
+
+        if(!finished_)
+            throw std::logic_error("json not finished");
+
+        if(&output_ == &buffer_){
+            output << buffer_.str();
+        }
+    }
+
+} // namespace json
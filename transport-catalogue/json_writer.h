@@ -0,0 +1,75 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+    // text of a finished value, what Writer gives instead of a Node
+    struct RawJson {
+        std::string text;
+    };
+
+    // OutputBuilder with the Builder interface that prints every call right away instead of
+    // keeping a node tree. Text is the same as Print gives for the tree of the same calls
+    class Writer {
+    public:
+
+        /* text is kept and given by Build or Print */
+        Writer();
+        /* text goes straight to output */
+        explicit Writer(std::ostream& output);
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        Writer& Value(std::nullptr_t value);
+        Writer& Value(bool value);
+        Writer& Value(int value);
+        Writer& Value(uint32_t value);
+        Writer& Value(double value);
+        Writer& Value(std::string_view value);
+        Writer& Value(const std::string& value);
+        Writer& Value(const char* value);
+        Writer& Value(const RawJson& value);
+        Writer& Value(const std::vector<RawJson>& value);
+
+        Writer& StartDict();
+        Writer& Key(std::string_view key);
+        Writer& EndDict();
+        Writer& StartArray();
+        Writer& EndArray();
+
+        /* finished value, for writers without output only */
+        RawJson Build();
+
+        /* kept text to output, writers with output have already written everything */
+        void Print(std::ostream& output);
+
+        using Node_t = RawJson;
+        using Array_t = std::vector<RawJson>;
+
+    private:
+
+        struct Level {
+            bool is_dict;
+            bool is_empty = true;
+            bool has_key = false;   // key is written, value is expected
+        };
+
+        void StartValue();
+        void EndValue();
+
+        std::ostringstream buffer_;
+        std::ostream& output_;
+
+        std::vector<Level> levels_;
+        bool finished_ = false;
+    };
+
+} // namespace json
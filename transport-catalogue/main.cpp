@@ -1,49 +1,89 @@
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <string_view>
 #include "transport_catalogue.h"
 #include "json_reader.h"
 #include "request_handler.h"
-#include "json_builder.h"
+#include "json_writer.h"
+#include "request_server.h"
 
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base [input_file]|process_requests [--verify] [input_file]|serve [socket_path]]\n"sv;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return 1;
     }
 
     const std::string_view mode(argv[1]);
 
+    if (mode == "serve"sv && argc <= 3) {
+
+        TC::RequestServer server;
+
+        if (argc == 3) {
+            server.ServeSocket(argv[2]);
+        } else {
+            server.Serve(std::cin, std::cout);
+        }
+
+        return 0;
+    }
+
+    // --verify recomputes the bus stats stored in the base instead of trusting them
+    const bool verify = mode == "process_requests"sv && argc >= 3 && argv[2] == "--verify"sv;
+    const int file_arg = verify ? 3 : 2;
+
+    if (argc > file_arg + 1) {
+        PrintUsage();
+        return 1;
+    }
+
     if (mode == "make_base"sv) {
 
         TC::TransportCatalogue catalogue;
         TC::RequestHandler request_handler(catalogue);
-        TC::Input::JSONReader reader(std::cin);
-        
-        request_handler.ReadRequests(reader);
 
-        auto file_name = request_handler.ReadSerializationSettings(reader);
+        auto make_base = [&request_handler](auto& reader) {
+            request_handler.ReadRequests(reader);
 
-        request_handler.SerializeToFile(file_name);
+            auto serialization_settings = request_handler.ReadSerializationSettings(reader);
+
+            request_handler.SerializeToFile(serialization_settings);
+        };
+
+        // input file is mapped and names are used in place, stdin goes through the streaming parser
+        if (argc == file_arg + 1) {
+            TC::Input::ViewJSONReader reader{std::string(argv[file_arg])};
+            make_base(reader);
+        } else {
+            TC::Input::StreamingJSONReader reader(std::cin);
+            make_base(reader);
+        }
 
     } else if (mode == "process_requests"sv) {
 
         TC::TransportCatalogue catalogue;
         TC::MapRenderer renderer;
         TC::RequestHandler request_handler(catalogue, &renderer);
-        TC::Input::JSONReader reader(std::cin);
+        std::optional<TC::Input::ViewJSONReader> reader;
+
+        if (argc == file_arg + 1) {
+            reader.emplace(std::string(argv[file_arg]));
+        } else {
+            reader.emplace(std::cin);
+        }
 
-        auto file_name = request_handler.ReadSerializationSettings(reader);
+        auto serialization_settings = request_handler.ReadSerializationSettings(*reader);
 
-        request_handler.DeserializeFromFile(file_name);
+        request_handler.DeserializeFromFile(serialization_settings.file, verify);
 
-        request_handler.ReadStatRequests(std::cout, reader, json::Builder{});
+        request_handler.ReadStatRequests(std::cout, *reader, json::Writer{std::cout});
 
     } else {
         PrintUsage();
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "csr_graph.h"
+#include "graph.h"
+
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// sources x targets weights without routes: one Dijkstra per source that stops
+// as soon as every target is settled, search arrays are reused between sources
+template <typename Weight>
+class ManyToManyRouter {
+
+public:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+    explicit ManyToManyRouter(const Graph& graph);
+
+    /* row-major, sources.size() rows of targets.size() weights, nullopt for unreachable pairs */
+    std::vector<std::optional<Weight>> BuildMatrix(const std::vector<VertexId>& sources,
+                                                   const std::vector<VertexId>& targets) const;
+
+private:
+    Weight ZERO_WEIGHT{};
+    CsrGraph<Weight> csr_graph_;
+};
+
+template <typename Weight>
+ManyToManyRouter<Weight>::ManyToManyRouter(const Graph& graph)
+    : csr_graph_(graph)
+{
+    for (const auto& edge : graph.GetEdges()) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> ManyToManyRouter<Weight>::BuildMatrix(const std::vector<VertexId>& sources,
+                                                                         const std::vector<VertexId>& targets) const {
+    const size_t vertex_count = csr_graph_.GetVertexCount();
+
+    std::vector<std::optional<Weight>> matrix(sources.size() * targets.size());
+
+    std::vector<bool> is_target(vertex_count, false);
+    size_t target_count = 0;
+    for (const VertexId target : targets) {
+        if (target < vertex_count && !is_target[target]) {
+            is_target[target] = true;
+            ++target_count;
+        }
+    }
+
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::vector<bool> settled(vertex_count, false);
+    std::vector<VertexId> touched;
+
+    using QueueItem = std::pair<Weight, VertexId>;
+
+    for (size_t row = 0; row < sources.size(); ++row) {
+        const VertexId source = sources[row];
+        if (source >= vertex_count) {
+            continue;
+        }
+
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        size_t targets_left = target_count;
+
+        weights[source] = ZERO_WEIGHT;
+        touched.push_back(source);
+        queue.push({ZERO_WEIGHT, source});
+
+        while (!queue.empty() && targets_left) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+
+            if (settled[vertex]) {
+                continue;
+            }
+            settled[vertex] = true;
+            if (is_target[vertex]) {
+                --targets_left;
+            }
+
+            for (const auto& edge : csr_graph_.GetIncidentEdges(vertex)) {
+                const Weight candidate_weight = weight + edge.weight;
+                auto& target_weight = weights[edge.to];
+                if (!target_weight || candidate_weight < *target_weight) {
+                    if (!target_weight) {
+                        touched.push_back(edge.to);
+                    }
+                    target_weight = candidate_weight;
+                    queue.push({candidate_weight, edge.to});
+                }
+            }
+        }
+
+        for (size_t column = 0; column < targets.size(); ++column) {
+            const VertexId target = targets[column];
+            if (target < vertex_count && settled[target]) {
+                matrix[row * targets.size() + column] = weights[target];
+            }
+        }
+
+        for (const VertexId vertex : touched) {
+            weights[vertex].reset();
+            settled[vertex] = false;
+        }
+        touched.clear();
+    }
+
+    return matrix;
+}
+
+}  // namespace graph
@@ -4,7 +4,7 @@ namespace TC {
 
     void MapRenderer::Render(std::vector<const Bus*>  buses, 
                     std::vector<const Stop*>  stops, 
-                    std::ostream& output){
+                    std::ostream& output) const{
 
         const auto coordinates = GetUsedCoordinates(buses);
 
@@ -53,7 +53,7 @@ namespace TC {
 
     }
 
-    void MapRenderer::DrawStopName(const Stop& stop, svg::Document& document, SphereProjector& projector){
+    void MapRenderer::DrawStopName(const Stop& stop, svg::Document& document, SphereProjector& projector) const{
         
         if(!stop.GetBusCount())
             return;
@@ -80,7 +80,7 @@ namespace TC {
         document.Add(text_foreground);
     }
 
-    void MapRenderer::DrawStopCircles(const Stop& stop, svg::Document& document, SphereProjector& projector){
+    void MapRenderer::DrawStopCircles(const Stop& stop, svg::Document& document, SphereProjector& projector) const{
         
         if(!stop.GetBusCount())
             return;
@@ -93,7 +93,7 @@ namespace TC {
         document.Add(circle);
     }
 
-    void MapRenderer::DrawRouteName(const Bus& bus, svg::Document& document, SphereProjector& projector, svg::Color color){
+    void MapRenderer::DrawRouteName(const Bus& bus, svg::Document& document, SphereProjector& projector, svg::Color color) const{
 
         if(!bus.GetStopsCount())
             return;
@@ -129,7 +129,7 @@ namespace TC {
         }
     }
 
-    void MapRenderer::DrawRoute(const Bus& bus, svg::Document& document, SphereProjector& projector, svg::Color color){
+    void MapRenderer::DrawRoute(const Bus& bus, svg::Document& document, SphereProjector& projector, svg::Color color) const{
         
         if(!bus.GetStopsCount())
             return;
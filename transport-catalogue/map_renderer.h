@@ -27,15 +27,15 @@ namespace TC {
 
         void Render(std::vector<const Bus*>  buses, 
                     std::vector<const Stop*>  stops, 
-                    std::ostream& output);
+                    std::ostream& output) const;
 
         void SetSettings(map_settings_t& settings);
 
     private:
-        void DrawRoute(const Bus& bus, svg::Document& document, SphereProjector& projector, svg::Color color);
-        void DrawRouteName(const Bus& bus, svg::Document& document, SphereProjector& projector, svg::Color color);
-        void DrawStopCircles (const Stop& bus, svg::Document& document, SphereProjector& projector);
-        void DrawStopName(const Stop& stop, svg::Document& document, SphereProjector& projector);
+        void DrawRoute(const Bus& bus, svg::Document& document, SphereProjector& projector, svg::Color color) const;
+        void DrawRouteName(const Bus& bus, svg::Document& document, SphereProjector& projector, svg::Color color) const;
+        void DrawStopCircles (const Stop& bus, svg::Document& document, SphereProjector& projector) const;
+        void DrawStopName(const Stop& stop, svg::Document& document, SphereProjector& projector) const;
 
         std::vector<Geo::Coordinates> GetUsedCoordinates(std::vector<const Bus*>& buses) const;
 
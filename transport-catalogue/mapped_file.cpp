@@ -0,0 +1,113 @@
+#include "mapped_file.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TC_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <filesystem>
+#endif
+
+namespace io {
+
+#ifdef TC_HAS_MMAP
+
+    MappedFile::MappedFile(const std::string& file_name){
+
+        const int fd = open(file_name.c_str(), O_RDONLY);
+        if(fd < 0){
+            throw std::runtime_error("Can't open " + file_name);
+        }
+
+        struct stat file_stat;
+        if(fstat(fd, &file_stat) != 0){
+            close(fd);
+            throw std::runtime_error("Can't stat " + file_name);
+        }
+
+        size_ = static_cast<size_t>(file_stat.st_size);
+
+        if(size_ > 0){
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data == MAP_FAILED){
+                close(fd);
+                throw std::runtime_error("Can't map " + file_name);
+            }
+            data_ = static_cast<const char*>(data);
+        }
+
+        // the mapping stays valid without the descriptor
+        close(fd);
+    }
+
+    MappedFile::~MappedFile(){
+        if(data_){
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    std::optional<FileVersion> GetFileVersion(const std::string& file_name){
+
+        struct stat file_stat;
+        if(stat(file_name.c_str(), &file_stat) != 0){
+            return std::nullopt;
+        }
+
+        FileVersion version;
+        version.id = static_cast<uint64_t>(file_stat.st_ino);
+#ifdef __APPLE__
+        version.modified_ns = static_cast<int64_t>(file_stat.st_mtimespec.tv_sec) * 1000000000 + file_stat.st_mtimespec.tv_nsec;
+#else
+        version.modified_ns = static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+#endif
+        version.size = static_cast<uint64_t>(file_stat.st_size);
+        return version;
+    }
+
+#else
+
+    MappedFile::MappedFile(const std::string& file_name){
+
+        std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+        if(!file){
+            throw std::runtime_error("Can't open " + file_name);
+        }
+
+        buffer_.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(buffer_.data(), buffer_.size());
+
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+
+    MappedFile::~MappedFile(){
+    }
+
+    std::optional<FileVersion> GetFileVersion(const std::string& file_name){
+
+        std::error_code error;
+        const auto modified = std::filesystem::last_write_time(file_name, error);
+        if(error){
+            return std::nullopt;
+        }
+        const auto size = std::filesystem::file_size(file_name, error);
+        if(error){
+            return std::nullopt;
+        }
+
+        FileVersion version;
+        version.modified_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(modified.time_since_epoch()).count();
+        version.size = static_cast<uint64_t>(size);
+        return version;
+    }
+
+#endif
+
+}  // namespace io
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace io {
+
+// tells a replaced or rewritten file from the one that was there before
+struct FileVersion {
+    uint64_t id = 0;            // inode where there are ones
+    int64_t modified_ns = 0;
+    uint64_t size = 0;
+
+    bool operator==(const FileVersion& other) const{
+        return id == other.id && modified_ns == other.modified_ns && size == other.size;
+    }
+    bool operator!=(const FileVersion& other) const{
+        return !(*this == other);
+    }
+};
+
+/* nullopt if there is no such file */
+std::optional<FileVersion> GetFileVersion(const std::string& file_name);
+
+// whole file mapped read-only, pages are loaded by the OS on first access.
+// Platforms without mmap get the file read into memory instead
+class MappedFile {
+
+public:
+    /* throws std::runtime_error if the file can't be opened or mapped */
+    explicit MappedFile(const std::string& file_name);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    const char* GetData() const{
+        return data_;
+    }
+
+    size_t GetSize() const{
+        return size_;
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<char> buffer_;  // used when mmap is not available
+};
+
+}  // namespace io
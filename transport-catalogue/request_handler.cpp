@@ -1,40 +1,106 @@
 #include "request_handler.h"
 #include "serialization.h"
 #include <algorithm>
+#include <cstdio>
 
 namespace TC {
 
-    void RequestHandler::SerializeToFile(std::string_view file_name){
-        TC_PROTO::TransportCatalogue* proto_transport = TransportCatalogueToProto(db_);
-        TC_PROTO::RenderSettings* proto_render_settings = RenderSettingsToProto(render_settings_);
-        TC_PROTO::TransportRouter* proto_router = TransportRouterToProto(*transport_router_);
+    void RequestHandler::SerializeToFile(const serialization_settings_t& settings){
 
-        TC_PROTO::BusManager bus_manager;
+        // the base is replaced rather than rewritten, a process that has it mapped keeps the old file
+        const std::string file_name(settings.file);
+        const std::string tmp_file_name = file_name + ".tmp";
+        {
+            std::ofstream file(tmp_file_name, std::ios::binary);
 
-        bus_manager.set_allocated_transport_catalogue(proto_transport);
-        bus_manager.set_allocated_render_settings(proto_render_settings);
-        bus_manager.set_allocated_transport_router(proto_router);
+            if(settings.format == base_format_t::FLAT){
+                WriteFlatBase(db_, render_settings_, *transport_router_, file);
+            } else {
+                WriteBusManager(db_, render_settings_, *transport_router_, file);
+            }
+
+            file.close();
+            if(!file){
+                std::remove(tmp_file_name.c_str());
+                throw std::runtime_error("Can't write " + tmp_file_name);
+            }
+        }
+
+        if(std::rename(tmp_file_name.c_str(), file_name.c_str()) != 0){
+            std::remove(tmp_file_name.c_str());
+            throw std::runtime_error("Can't replace " + file_name);
+        }
+    }
+
+    void RequestHandler::DeserializeFromFile(std::string_view file_name, bool verify){
+
+        auto base_file = std::make_shared<const io::MappedFile>(std::string(file_name));
+
+        flat_catalogue_.reset();
+
+        if(FlatBase::IsFlatBase(*base_file)){
+            auto flat_catalogue = std::make_unique<FlatCatalogue>(base_file);
+            if(flat_catalogue->HasLookups() && !verify){
+                ReadFlatRenderSettings(render_settings_, flat_catalogue->GetReader());
+                flat_catalogue_ = std::move(flat_catalogue);
+                return;
+            }
+            transport_router_ = std::make_unique<TransportRouter>(db_);
+            ReadFlatBase(db_, render_settings_, *transport_router_, std::move(base_file));
+        } else {
+            transport_router_ = std::make_unique<TransportRouter>(db_);
+            DeseriallizeBusManager(db_, render_settings_, *transport_router_, std::move(base_file));
+        }
+
+        if(verify){
+            VerifyBusStats();
+        }
+    }
 
-        std::ofstream file(std::string(file_name), std::ios::binary);
+    void RequestHandler::VerifyBusStats() const {
+        for(const auto& bus : db_.GetBuses()){
+            if(db_.ComputeRouteStats(bus) != bus.GetStats()){
+                throw std::runtime_error("Stored stats of bus " + bus.GetNameStr() + " don't match its route");
+            }
+        }
+    }
 
-        bus_manager.SerializeToOstream(&file);
+    bool RequestHandler::NeedsLoadedBase(request_type_t type){
+        return type == request_type_t::MAP || type == request_type_t::ROUTE || type == request_type_t::ROUTE_MATRIX;
     }
 
-    void RequestHandler::DeserializeFromFile(std::string_view file_name){
+    void RequestHandler::LoadDeferredBase(){
 
-        std::ifstream file(std::string(file_name), std::ios::binary);
+        // the catalogue may be half filled by a failed load, it's not loaded into again
+        if(deferred_load_failed_){
+            throw std::runtime_error("Base failed to load");
+        }
+
+        try{
+            transport_router_ = std::make_unique<TransportRouter>(db_);
+            ReadFlatBase(db_, render_settings_, *transport_router_, flat_catalogue_->GetReader().GetFile());
+        } catch(...){
+            deferred_load_failed_ = true;
+            throw;
+        }
 
-        transport_router_ = std::make_unique<TransportRouter>(db_);
+        // the catalogue answers everything from now on
+        flat_catalogue_.reset();
+    }
 
-        DeseriallizeBusManager(db_, render_settings_, *transport_router_, file);
+    parallel::ThreadPool& RequestHandler::GetThreadPool(){
+        if(!thread_pool_){
+            thread_pool_ = std::make_unique<parallel::ThreadPool>();
+        }
+        return *thread_pool_;
     }
 
     void RequestHandler::QueueAddRequest(base_request_t& request) {
 
-        if (request.type == "Stop"){
+        if (request.type == request_type_t::STOP){
             requests_add_stop.push_back(std::move(request));
         } else 
-        if (request.type == "Bus"){
+        if (request.type == request_type_t::BUS){
             requests_add_bus.push_back(std::move(request));
         }
     }
@@ -64,6 +130,15 @@ namespace TC {
 
     std::optional<RequestHandler::stat_bus_t> RequestHandler::GetBusStat(const std::string_view& bus_name) const {
 
+        if(flat_catalogue_){
+            const auto* bus_stats = flat_catalogue_->FindBusStats(bus_name);
+            if(!bus_stats){
+                return std::nullopt;
+            }
+            return stat_bus_t{bus_stats->curvature, bus_stats->route_length
+                            , static_cast<int>(bus_stats->stop_count), static_cast<int>(bus_stats->unique_stop_count)};
+        }
+
         if (!db_.ContainsBus(bus_name))
             return std::nullopt;
 
@@ -80,13 +155,21 @@ namespace TC {
     }
 
     std::optional<RequestHandler::stat_stop_t> RequestHandler::GetStopStat(const std::string_view& stop_name) const {
-        
+
+        if(flat_catalogue_){
+            auto buses = flat_catalogue_->FindStopBuses(stop_name);
+            if(!buses){
+                return std::nullopt;
+            }
+            return stat_stop_t{std::move(*buses)};
+        }
+
         if (!db_.ContainsStop(stop_name))
             return std::nullopt;
 
         const auto stop = db_.GetStop(stop_name);
 
-        stat_stop_t stop_stat{stop->GetBuses()};
+        stat_stop_t stop_stat{{stop->GetBuses().begin(), stop->GetBuses().end()}};
 
         return stop_stat;
 
@@ -1,12 +1,15 @@
 #pragma once
 
+#include <algorithm>
 #include <optional>
 #include <unordered_set>
 #include <map>
 #include <optional>
 #include <sstream>
 #include "domain.h"
+#include "flat_catalogue.h"
 #include "map_renderer.h"
+#include "thread_pool.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
@@ -29,7 +32,7 @@ class RequestHandler {
         };
 
         struct stat_stop_t{
-            const std::set<std::string_view>& buses;
+            std::vector<std::string_view> buses;
         };
         
         RequestHandler(TransportCatalogue& db, Renderer *renderer = nullptr) : db_(db), renderer_(renderer){};
@@ -37,8 +40,14 @@ class RequestHandler {
         template <typename Array, typename Dict, typename Node>
         void ReadRequests(Reader<Array, Dict, Node>& reader);
 
+        /* builder is either one that keeps a tree and prints it to output at the end
+           or a streaming one already writing to output */
         template <typename Array, typename Dict, typename Node, typename OutputBuilder>
-        void ReadStatRequests(std::ostream& output, Reader<Array, Dict, Node>& reader, OutputBuilder);
+        void ReadStatRequests(std::ostream& output, Reader<Array, Dict, Node>& reader, OutputBuilder builder);
+
+        /* answers document that is one stat request itself */
+        template <typename Array, typename Dict, typename Node, typename OutputBuilder>
+        void ReadStatRequest(std::ostream& output, Reader<Array, Dict, Node>& reader, OutputBuilder builder);
 
         /* stores add request for later fulfillment */
         void QueueAddRequest(base_request_t& request);
@@ -57,14 +66,28 @@ class RequestHandler {
         std::vector<const Bus*> GetBusesAscendingName() const;
         std::vector<const Stop*> GetStopsAscendingName() const;
 
-        void SerializeToFile(std::string_view file_name);
-        void DeserializeFromFile(std::string_view file_name);
+        /* written next to the file and renamed over it, so readers that have the old base mapped keep it */
+        void SerializeToFile(const serialization_settings_t& settings);
+        /* format of the base is told by its first bytes. A flat base with lookup sections
+           is only mapped, Bus and Stop requests are answered from it in place and
+           the rest of it is loaded by the first request that needs the router or the map.
+           Bus stats stored in the base are trusted, with verify the base is loaded at once
+           and the stats are computed again, std::runtime_error is thrown if they differ */
+        void DeserializeFromFile(std::string_view file_name, bool verify = false);
 
         template <typename Array, typename Dict, typename Node>
-        inline std::string_view ReadSerializationSettings(Reader<Array, Dict, Node>& reader);
+        inline serialization_settings_t ReadSerializationSettings(Reader<Array, Dict, Node>& reader);
+
+        /* false once loading what DeserializeFromFile deferred has failed, only Bus and Stop
+           requests are answered then and the base has to be loaded by another handler */
+        bool IsBaseUsable() const{
+            return !deferred_load_failed_;
+        }
 
     private:
 
+        static constexpr size_t statRequestsChunk = 1024;  // answers kept at once while answering a batch
+
         std::vector<base_request_t> requests_add_stop;
         std::vector<base_request_t> requests_add_bus;
 
@@ -72,6 +95,28 @@ class RequestHandler {
         Renderer *renderer_;
         map_settings_t render_settings_;
         std::unique_ptr<TransportRouter> transport_router_;
+        std::unique_ptr<parallel::ThreadPool> thread_pool_;    // created by the first stat requests
+        std::unique_ptr<FlatCatalogue> flat_catalogue_;         // set while the base is not loaded
+        bool deferred_load_failed_ = false;
+
+        /* true for requests that can't be answered from FlatCatalogue */
+        static bool NeedsLoadedBase(request_type_t type);
+
+        /* throws std::runtime_error if stats of a bus differ from computed ones */
+        void VerifyBusStats() const;
+
+        /* loads what DeserializeFromFile deferred, called before answering requests in parallel */
+        void LoadDeferredBase();
+
+        parallel::ThreadPool& GetThreadPool();
+
+        /* reads all fields of a stat request */
+        template <typename Array, typename Dict, typename Node>
+        stat_request_t ParseStatRequest(Reader<Array, Dict, Node>& reader, const Node& request_node);
+
+        /* answers one stat request, called concurrently for requests of a batch */
+        template <typename OutputBuilder>
+        typename OutputBuilder::Node_t ExecuteStatRequest(const stat_request_t& request);
 
         template <typename Array, typename Dict, typename Node>
         routing_settings_t ReadRoutingSettings(Reader<Array, Dict, Node>& reader);
@@ -82,6 +127,9 @@ class RequestHandler {
         template <typename OutputBuilder>
         typename OutputBuilder::Node_t BuildRouteNode(int id, const TransportRouter::Travel& travel);
 
+        template <typename OutputBuilder>
+        typename OutputBuilder::Node_t BuildRouteMatrixNode(int id, const TransportRouter::TravelTimes& travel_times);
+
         template <typename OutputBuilder>
         typename OutputBuilder::Node_t BuildBusStatNode(int id, const stat_bus_t& bus_stat);
 
@@ -89,7 +137,7 @@ class RequestHandler {
         typename OutputBuilder::Node_t BuildStopStatNode(int id, const stat_stop_t& stop_stat);
 
         template <typename OutputBuilder>
-        typename OutputBuilder::Node_t BuildMapStatNode(int id, map_settings_t& map_settings);
+        typename OutputBuilder::Node_t BuildMapStatNode(int id);
 
         template <typename OutputBuilder>
         typename OutputBuilder::Node_t BuildNotFoundNode(int id);
@@ -121,7 +169,7 @@ namespace detail {
             }
         } else 
         if (node.IsString()){
-            return node.AsString();
+            return std::string(node.AsString());
         }
     return svg::Rgb();
     }
@@ -131,35 +179,43 @@ namespace detail {
 template <typename Array, typename Dict, typename Node>
 void RequestHandler::ReadRequests(Reader<Array, Dict, Node>& reader){
 
-    const auto request_nodes = reader.GetRequestNodesAsArray("base_requests");
+    if(auto* parsed_requests = reader.GetParsedBaseRequests()){
 
-    for(const auto& request_node : request_nodes){
+        for(auto& request : *parsed_requests){
+            QueueAddRequest(request);
+        }
 
-        base_request_t request;
+    } else {
 
-        if(reader.GetFieldAsString(request_node, "type") == "Bus"){
-                
-                request.type = "Bus";
-                request.name = reader.GetFieldAsString(request_node, "name");
-                request.is_roundtrip = reader.GetFieldAsBool(request_node, "is_roundtrip");
+        const auto& request_nodes = reader.GetRequestNodesAsArray("base_requests");
 
-                for(const auto& stop_node : reader.GetFieldAsArrayNodes(request_node, "stops")){
-                    request.stops.push_back(stop_node.AsString());
-                }
-        } else 
-        if(reader.GetFieldAsString(request_node, "type") == "Stop"){
+        for(const auto& request_node : request_nodes){
 
-            request.type = "Stop";
-            request.name = reader.GetFieldAsString(request_node, "name");
-            request.latitude = reader.GetFieldAsDouble(request_node, "latitude");
-            request.longitude = reader.GetFieldAsDouble(request_node, "longitude");
+            base_request_t request;
+            request.type = ParseRequestType(reader.GetFieldAsString(request_node, "type"));
+
+            if(request.type == request_type_t::BUS){
+                    
+                    request.name = reader.GetFieldAsString(request_node, "name");
+                    request.is_roundtrip = reader.GetFieldAsBool(request_node, "is_roundtrip");
+
+                    for(const auto& stop_node : reader.GetFieldAsArrayNodes(request_node, "stops")){
+                        request.stops.push_back(stop_node.AsString());
+                    }
+            } else 
+            if(request.type == request_type_t::STOP){
+
+                request.name = reader.GetFieldAsString(request_node, "name");
+                request.latitude = reader.GetFieldAsDouble(request_node, "latitude");
+                request.longitude = reader.GetFieldAsDouble(request_node, "longitude");
 
-            for(const auto& [name, dist_node]: reader.GetFieldAsMapNodes(request_node, "road_distances")){
-                request.road_distances.insert({name, dist_node.AsInt()});
+                for(const auto& [name, dist_node]: reader.GetFieldAsMapNodes(request_node, "road_distances")){
+                    request.road_distances.insert({name, dist_node.AsInt()});
+                }
             }
-        }
 
-        QueueAddRequest(request);
+            QueueAddRequest(request);
+        }
     }
 
     FulfillAddRequests();
@@ -172,70 +228,150 @@ void RequestHandler::ReadRequests(Reader<Array, Dict, Node>& reader){
 }
 
 template <typename Array, typename Dict, typename Node, typename OutputBuilder>
-void RequestHandler::ReadStatRequests(std::ostream& output, Reader<Array, Dict, Node>& reader, OutputBuilder){
+void RequestHandler::ReadStatRequests(std::ostream& output, Reader<Array, Dict, Node>& reader, OutputBuilder builder){
 
-    using namespace std::string_literals;
+    const auto& request_nodes = reader.GetRequestNodesAsArray("stat_requests");
 
-    const auto request_nodes = reader.GetRequestNodesAsArray("stat_requests");
+    std::vector<stat_request_t> requests;
+    requests.reserve(request_nodes.size());
+    for(const auto& request_node : request_nodes){
+        requests.push_back(ParseStatRequest(reader, request_node));
+    }
 
-    typename OutputBuilder::Array_t array_output;
+    if(flat_catalogue_ && std::any_of(requests.begin(), requests.end(), [](const stat_request_t& request){
+            return NeedsLoadedBase(request.type);
+        })){
+        LoadDeferredBase();
+    }
 
-    for(const auto& request_node : request_nodes){
+    if(renderer_){
+        renderer_->SetSettings(render_settings_);
+    }
 
-        typename OutputBuilder::Node_t request_output;
+    builder.StartArray();
 
-        int request_id = reader.GetFieldAsInt(request_node, "id");
+    // requests only read the catalogue and the router, so they go to the pool,
+    // every answer gets the slot of its request to keep the order.
+    // Answers are handed to the builder a chunk at a time, a streaming one doesn't keep them
+    for(size_t chunk_begin = 0; chunk_begin < requests.size(); chunk_begin += statRequestsChunk){
 
-        if(reader.GetFieldAsString(request_node, "type") == "Bus"){
+        const size_t chunk_size = std::min(statRequestsChunk, requests.size() - chunk_begin);
+        typename OutputBuilder::Array_t answers(chunk_size);
 
-            const auto& name = reader.GetFieldAsString(request_node, "name");
+        GetThreadPool().ParallelFor(chunk_size, [&](size_t index){
+            answers[index] = ExecuteStatRequest<OutputBuilder>(requests[chunk_begin + index]);
+        });
 
-            if (const auto& bus_stat = GetBusStat(name)){
-                request_output = BuildBusStatNode<OutputBuilder>(request_id, *bus_stat);
-            } else {
-                request_output = BuildNotFoundNode<OutputBuilder>(request_id);
+        for(const auto& answer : answers){
+            builder.Value(answer);
+        }
+    }
+
+    builder.EndArray();
+    builder.Print(output);
+}
+
+template <typename Array, typename Dict, typename Node, typename OutputBuilder>
+void RequestHandler::ReadStatRequest(std::ostream& output, Reader<Array, Dict, Node>& reader, OutputBuilder builder){
+
+    const auto request = ParseStatRequest(reader, reader.GetRootNode());
+
+    if(flat_catalogue_ && NeedsLoadedBase(request.type)){
+        LoadDeferredBase();
+    }
+
+    if(renderer_){
+        renderer_->SetSettings(render_settings_);
+    }
+
+    builder.Value(ExecuteStatRequest<OutputBuilder>(request));
+    builder.Print(output);
+}
+
+template <typename Array, typename Dict, typename Node>
+stat_request_t RequestHandler::ParseStatRequest(Reader<Array, Dict, Node>& reader, const Node& request_node){
+
+    stat_request_t request;
+
+    request.id = reader.GetFieldAsInt(request_node, "id");
+    request.type = ParseRequestType(reader.GetFieldAsString(request_node, "type"));
+
+    switch(request.type){
+        case request_type_t::BUS:
+        case request_type_t::STOP:
+            request.name = reader.GetFieldAsString(request_node, "name");
+            break;
+        case request_type_t::ROUTE:
+            request.from = reader.GetFieldAsString(request_node, "from");
+            request.to = reader.GetFieldAsString(request_node, "to");
+            break;
+        case request_type_t::ROUTE_MATRIX:
+            for(const auto& stop_node : reader.GetFieldAsArrayNodes(request_node, "from")){
+                request.from_stops.push_back(stop_node.AsString());
             }
-        } else 
-        if (reader.GetFieldAsString(request_node, "type") == "Stop"){
+            for(const auto& stop_node : reader.GetFieldAsArrayNodes(request_node, "to")){
+                request.to_stops.push_back(stop_node.AsString());
+            }
+            break;
+        default:
+            break;
+    }
 
-            const auto& name = reader.GetFieldAsString(request_node, "name");
+    return request;
+}
 
-            if (const auto& stop_stat = GetStopStat(name)){
-                request_output = BuildStopStatNode<OutputBuilder>(request_id, *stop_stat);
-            } else {
-                request_output = BuildNotFoundNode<OutputBuilder>(request_id);
+template <typename OutputBuilder>
+typename OutputBuilder::Node_t RequestHandler::ExecuteStatRequest(const stat_request_t& request){
+
+    switch(request.type){
+        case request_type_t::BUS:
+            if (const auto& bus_stat = GetBusStat(request.name)){
+                return BuildBusStatNode<OutputBuilder>(request.id, *bus_stat);
             }
-        } else 
-        if (reader.GetFieldAsString(request_node, "type") == "Map"){
-            request_output = BuildMapStatNode<OutputBuilder>(request_id, render_settings_);
-        } else 
-        if (reader.GetFieldAsString(request_node, "type") == "Route"){
+            return BuildNotFoundNode<OutputBuilder>(request.id);
+
+        case request_type_t::STOP:
+            if (const auto& stop_stat = GetStopStat(request.name)){
+                return BuildStopStatNode<OutputBuilder>(request.id, *stop_stat);
+            }
+            return BuildNotFoundNode<OutputBuilder>(request.id);
 
-            const auto from = reader.GetFieldAsString(request_node, "from");
-            const auto to = reader.GetFieldAsString(request_node, "to");
+        case request_type_t::MAP:
+            return BuildMapStatNode<OutputBuilder>(request.id);
 
-            const auto route = transport_router_->Route(from, to);
-            if(route){
-                request_output = BuildRouteNode<OutputBuilder>(request_id, *route);
-            } else{
-                request_output = BuildNotFoundNode<OutputBuilder>(request_id);
+        case request_type_t::ROUTE:
+            if (const auto route = transport_router_->Route(request.from, request.to)){
+                return BuildRouteNode<OutputBuilder>(request.id, *route);
             }
-           
-        }
+            return BuildNotFoundNode<OutputBuilder>(request.id);
 
-        array_output.push_back(request_output);
+        case request_type_t::ROUTE_MATRIX:
+            return BuildRouteMatrixNode<OutputBuilder>(request.id, transport_router_->RouteMatrix(request.from_stops, request.to_stops));
 
+        default:
+            return OutputBuilder{}.Value(nullptr).Build();
     }
-
-    OutputBuilder{}.Value(array_output).Print(output);
 }
 
 template <typename Array, typename Dict, typename Node>
-std::string_view RequestHandler::ReadSerializationSettings(Reader<Array, Dict, Node>& reader){
+serialization_settings_t RequestHandler::ReadSerializationSettings(Reader<Array, Dict, Node>& reader){
 
     const auto& settings_map = reader.GetRequestNodesAsMap("serialization_settings");
 
-    return reader.GetFieldAsString(settings_map, "file");
+    serialization_settings_t settings;
+    settings.file = reader.GetFieldAsString(settings_map, "file");
+
+    if(reader.HasField(settings_map, "format")){
+        const auto& format = reader.GetFieldAsString(settings_map, "format");
+        if(format == "protobuf"){
+            settings.format = base_format_t::PROTOBUF;
+        } else
+        if(format != "flat"){
+            throw std::invalid_argument("Unknown base format: " + std::string(format));
+        }
+    }
+
+    return settings;
 }
 
 template <typename Array, typename Dict, typename Node>
@@ -245,6 +381,36 @@ inline routing_settings_t RequestHandler::ReadRoutingSettings(Reader<Array, Dict
     routing_settings_t settings;
     settings.bus_velocity_kmh = reader.GetFieldAsInt(settings_map, "bus_velocity");
     settings.bus_wait_time_min = reader.GetFieldAsInt(settings_map, "bus_wait_time");
+
+    if(reader.HasField(settings_map, "router")){
+        const auto& router = reader.GetFieldAsString(settings_map, "router");
+        if(router == "all_pairs"){
+            settings.router_type = router_type_t::ALL_PAIRS;
+        } else
+        if(router == "dijkstra"){
+            settings.router_type = router_type_t::DIJKSTRA;
+        } else
+        if(router == "contraction_hierarchy"){
+            settings.router_type = router_type_t::CONTRACTION_HIERARCHY;
+        } else
+        if(router == "astar"){
+            settings.router_type = router_type_t::ASTAR;
+        } else
+        if(router != "auto"){
+            throw std::invalid_argument("Unknown router type: " + std::string(router));
+        }
+    }
+
+    if(reader.HasField(settings_map, "graph_model")){
+        const auto& graph_model = reader.GetFieldAsString(settings_map, "graph_model");
+        if(graph_model == "compact"){
+            settings.graph_model = graph_model_t::COMPACT;
+        } else
+        if(graph_model != "complete"){
+            throw std::invalid_argument("Unknown graph model: " + std::string(graph_model));
+        }
+    }
+
     return settings;
 }
 
@@ -282,44 +448,73 @@ inline map_settings_t RequestHandler::ReadMapRenderSettings(Reader<Array, Dict,
     return settings;
 }
 
+// builders below only use the fluent calls, so a streaming OutputBuilder writes them without
+// a tree. Keys go in the order the tree printer sorts them in
 template <typename OutputBuilder>
 inline typename OutputBuilder::Node_t RequestHandler::BuildRouteNode(int id, const TransportRouter::Travel& travel){
 
-    using namespace std::string_literals;
-
-    typename OutputBuilder::Array_t items;
+    OutputBuilder builder;
+    builder.StartDict().Key("items").StartArray();
 
     for(const auto& t : travel.lines){
 
-        typename OutputBuilder::Dict_t item;
-
         if(t.type == TransportRouter::RouteLine_t::BUS){
-            (item)["bus"] = std::string(t.name);
-            (item)["span_count"] = static_cast<uint32_t>(t.span_count);
-            (item)["time"] = t.time_min;
-            (item)["type"] = "Bus"s;
-            
+            builder.StartDict()
+                .Key("bus").Value(t.name)
+                .Key("span_count").Value(static_cast<uint32_t>(t.span_count))
+                .Key("time").Value(t.time_min)
+                .Key("type").Value(std::string_view("Bus"))
+                .EndDict();
         } else
         if(t.type == TransportRouter::RouteLine_t::WAIT){
-            (item)["stop_name"] = std::string(t.name);
-            (item)["time"] = t.time_min;
-            (item)["type"] = "Wait"s;
+            builder.StartDict()
+                .Key("stop_name").Value(t.name)
+                .Key("time").Value(t.time_min)
+                .Key("type").Value(std::string_view("Wait"))
+                .EndDict();
         }
-        items.push_back(std::move(item));
     }
 
-    return OutputBuilder{}.StartDict()
-        .Key("items").Value(items)
+    builder.EndArray()
         .Key("request_id").Value(id)
         .Key("total_time").Value(travel.total_time_min)
-        .EndDict().Build();
+        .EndDict();
+
+    return builder.Build();
+}
+
+template <typename OutputBuilder>
+inline typename OutputBuilder::Node_t RequestHandler::BuildRouteMatrixNode(int id, const TransportRouter::TravelTimes& travel_times){
+
+    OutputBuilder builder;
+    builder.StartDict()
+        .Key("request_id").Value(id)
+        .Key("total_time").StartArray();
+
+    for(const auto& travel_times_row : travel_times){
+
+        builder.StartArray();
+
+        for(const auto& time : travel_times_row){
+            if(time){
+                builder.Value(*time);
+            } else {
+                builder.Value(nullptr);
+            }
+        }
+        builder.EndArray();
+    }
+
+    builder.EndArray().EndDict();
+
+    return builder.Build();
 }
 
 template <typename OutputBuilder>
 inline typename OutputBuilder::Node_t RequestHandler::BuildBusStatNode(int id, const stat_bus_t& bus_stat){
     return OutputBuilder{}.StartDict()
-            .Key("request_id").Value(id)
             .Key("curvature").Value(bus_stat.curvature)
+            .Key("request_id").Value(id)
             .Key("route_length").Value(bus_stat.length)
             .Key("stop_count").Value(bus_stat.stop_count)
             .Key("unique_stop_count").Value(bus_stat.unique_stop_count)
@@ -328,38 +523,38 @@ inline typename OutputBuilder::Node_t RequestHandler::BuildBusStatNode(int id, c
 
 template <typename OutputBuilder>
 inline typename OutputBuilder::Node_t RequestHandler::BuildStopStatNode(int id, const stat_stop_t& stop_stat){
-    typename OutputBuilder::Array_t stops;
-                    
+
+    OutputBuilder builder;
+    builder.StartDict().Key("buses").StartArray();
+
     for(const auto stop : stop_stat.buses){
-        stops.push_back(OutputBuilder{}.Value(std::string(stop)).Build());
+        builder.Value(stop);
     }
 
-    return OutputBuilder{}.StartDict()
+    builder.EndArray()
         .Key("request_id").Value(id)
-        .Key("buses").Value(stops)
-        .EndDict().Build();
+        .EndDict();
+
+    return builder.Build();
 }
 
 template <typename OutputBuilder>
-inline typename OutputBuilder::Node_t RequestHandler::BuildMapStatNode(int id, map_settings_t& map_settings){
-    
-    renderer_->SetSettings(map_settings);
+inline typename OutputBuilder::Node_t RequestHandler::BuildMapStatNode(int id){
 
     std::stringstream stream;
     renderer_->Render(GetBusesAscendingName(), GetStopsAscendingName(), stream);
 
     return OutputBuilder{}.StartDict()
-            .Key("request_id").Value(id)
             .Key("map").Value(stream.str())
+            .Key("request_id").Value(id)
             .EndDict().Build();
 }
 
 template <typename OutputBuilder>
 inline typename OutputBuilder::Node_t RequestHandler::BuildNotFoundNode(int id){
-    using namespace std::string_literals;
     return OutputBuilder{}.StartDict()
+            .Key("error_message").Value(std::string_view("not found"))
             .Key("request_id").Value(id)
-            .Key("error_message").Value("not found"s)
             .EndDict().Build();
 }
 
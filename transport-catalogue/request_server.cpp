@@ -0,0 +1,252 @@
+#include "request_server.h"
+#include "json_builder.h"
+#include "json_reader.h"
+#include "json_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TC_HAS_UNIX_SOCKETS
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace TC {
+
+    namespace detail {
+
+        // the printer escapes line breaks inside strings, so the rest of them are only layout
+        inline void RemoveLineBreaks(std::string& text){
+            text.erase(std::remove(text.begin(), text.end(), '\n'), text.end());
+        }
+
+        inline std::string ErrorLine(std::string_view message){
+            std::stringstream stream;
+            json::Builder{}.StartDict()
+                .Key("error_message").Value(std::string(message))
+                .EndDict().Print(stream);
+
+            std::string result = stream.str();
+            RemoveLineBreaks(result);
+            return result;
+        }
+
+#ifdef TC_HAS_UNIX_SOCKETS
+        inline bool WriteAll(int fd, std::string_view data){
+#ifdef MSG_NOSIGNAL
+            const int flags = MSG_NOSIGNAL;     // a gone client is an error, not a signal
+#else
+            const int flags = 0;
+#endif
+            while(!data.empty()){
+                const ssize_t written = send(fd, data.data(), data.size(), flags);
+                if(written <= 0){
+                    return false;
+                }
+                data.remove_prefix(static_cast<size_t>(written));
+            }
+            return true;
+        }
+#endif
+    } // namespace detail
+
+    void RequestServer::LoadBase(std::string_view file_name){
+
+        // a failed load leaves no base rather than a half loaded one
+        request_handler_.reset();
+        base_file_name_.clear();
+
+        // taken before loading, a file replaced meanwhile is seen as changed by the next line
+        const auto version = io::GetFileVersion(std::string(file_name));
+
+        catalogue_ = std::make_unique<TransportCatalogue>();
+        renderer_ = std::make_unique<MapRenderer>();
+        request_handler_ = std::make_unique<RequestHandler>(*catalogue_, renderer_.get());
+
+        try{
+            request_handler_->DeserializeFromFile(file_name);
+        } catch(...){
+            request_handler_.reset();
+            throw;
+        }
+
+        base_file_name_ = std::string(file_name);
+        base_file_version_ = version;
+    }
+
+    bool RequestServer::IsBaseChanged() const{
+        // a removed file leaves the loaded base as it is, its mapping is still there
+        const auto version = io::GetFileVersion(base_file_name_);
+        return version && version != base_file_version_;
+    }
+
+    std::string RequestServer::ProcessLine(std::string_view line){
+
+        try{
+            std::istringstream input{std::string(line)};
+            Input::JSONReader reader(input);
+
+            if(reader.HasRequestNodes("serialization_settings")){
+                const auto& file_name = reader.GetFieldAsString(reader.GetRequestNodesAsMap("serialization_settings"), "file");
+                if(!request_handler_ || file_name != base_file_name_){
+                    LoadBase(file_name);
+                }
+            }
+
+            // dropped after a failed load or changed since it was loaded
+            if(!base_file_name_.empty() && (!request_handler_ || IsBaseChanged())){
+                LoadBase(std::string(base_file_name_));
+            }
+
+            if(!request_handler_){
+                return detail::ErrorLine("no base loaded");
+            }
+
+            std::stringstream output;
+            if(reader.HasRequestNodes("type")){
+                request_handler_->ReadStatRequest(output, reader, json::Writer{output});
+            } else
+            if(reader.HasRequestNodes("stat_requests")){
+                request_handler_->ReadStatRequests(output, reader, json::Writer{output});
+            } else {
+                // settings only
+                json::Builder{}.StartArray().EndArray().Print(output);
+            }
+
+            std::string result = output.str();
+            detail::RemoveLineBreaks(result);
+            return result;
+
+        } catch(const std::exception& e){
+            // a base that failed to load in the middle is dropped, the next line loads it again
+            if(request_handler_ && !request_handler_->IsBaseUsable()){
+                request_handler_.reset();
+            }
+            return detail::ErrorLine(e.what());
+        }
+    }
+
+    void RequestServer::Serve(std::istream& input, std::ostream& output){
+
+        std::string line;
+
+        while(std::getline(input, line)){
+            if(line.find_first_not_of(" \t\r") == std::string::npos){
+                continue;
+            }
+            output << ProcessLine(line) << '\n';
+            output.flush();
+        }
+    }
+
+#ifdef TC_HAS_UNIX_SOCKETS
+
+    void RequestServer::ServeSocket(const std::string& socket_path){
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if(socket_path.size() >= sizeof(address.sun_path)){
+            throw std::invalid_argument("Socket path is too long: " + socket_path);
+        }
+        std::copy(socket_path.begin(), socket_path.end(), address.sun_path);
+
+        const int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(server_fd < 0){
+            throw std::runtime_error("Can't create socket");
+        }
+
+        // only a socket left by an earlier run is replaced, never a file that happens to have the name
+        struct stat existing{};
+        if(lstat(socket_path.c_str(), &existing) == 0){
+            if(!S_ISSOCK(existing.st_mode)){
+                close(server_fd);
+                throw std::runtime_error("Not a socket, won't replace " + socket_path);
+            }
+            unlink(socket_path.c_str());
+        }
+        if(bind(server_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || listen(server_fd, 16) != 0){
+            close(server_fd);
+            throw std::runtime_error("Can't listen on " + socket_path);
+        }
+
+        std::string buffer;
+        char chunk[4096];
+
+        while(true){
+            const int client_fd = accept(server_fd, nullptr, nullptr);
+            if(client_fd < 0){
+                if(errno == EINTR || errno == ECONNABORTED){
+                    continue;
+                }
+                // out of descriptors or buffers, clients wait in the backlog until some are freed
+                if(errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM){
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    continue;
+                }
+                close(server_fd);
+                throw std::runtime_error("Can't accept on " + socket_path);
+            }
+
+            buffer.clear();
+            bool connected = true;
+
+            while(connected){
+                const ssize_t received = recv(client_fd, chunk, sizeof(chunk), 0);
+                // what was left in the buffer has no line breaks
+                const size_t scan_from = buffer.size();
+                if(received < 0){
+                    break;
+                }
+                if(received == 0){
+                    // the last request of a client that shut its side down may have no line break
+                    if(buffer.empty()){
+                        break;
+                    }
+                    buffer.push_back('\n');
+                    connected = false;
+                } else {
+                    buffer.append(chunk, static_cast<size_t>(received));
+                }
+
+                size_t line_begin = 0;
+                for(size_t line_end = buffer.find('\n', scan_from); line_end != std::string::npos; line_end = buffer.find('\n', line_begin)){
+                    const std::string_view line(buffer.data() + line_begin, line_end - line_begin);
+                    line_begin = line_end + 1;
+
+                    if(line.find_first_not_of(" \t\r") == std::string_view::npos){
+                        continue;
+                    }
+                    if(!detail::WriteAll(client_fd, ProcessLine(line) + '\n')){
+                        connected = false;
+                        break;
+                    }
+                }
+                buffer.erase(0, line_begin);
+
+                if(connected && buffer.size() > maxSocketLineSize){
+                    detail::WriteAll(client_fd, detail::ErrorLine("request line is too long") + '\n');
+                    break;
+                }
+            }
+
+            close(client_fd);
+        }
+    }
+
+#else
+
+    void RequestServer::ServeSocket(const std::string& socket_path){
+        throw std::runtime_error("Unix domain sockets are not supported, can't listen on " + socket_path);
+    }
+
+#endif
+
+} // namespace TC
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "map_renderer.h"
+#include "mapped_file.h"
+#include "request_handler.h"
+#include "transport_catalogue.h"
+
+namespace TC {
+
+// serve mode: keeps the base loaded between request batches.
+// Every input line is either a process_requests document or a single stat request.
+// serialization_settings may be omitted once a base is loaded. The base is loaded again when
+// another file is named or the file is replaced or rewritten, which is checked for every line.
+// Every line gets one line of answer as soon as it is read: the answers array for a document,
+// the answer object for a single request, so memory only depends on the longest line
+class RequestServer {
+
+public:
+    // a socket client whose line grows longer than this gets an error_message line and is disconnected
+    static constexpr size_t maxSocketLineSize = 16 * 1024 * 1024;
+
+    /* answers lines of input until it ends */
+    void Serve(std::istream& input, std::ostream& output);
+
+    /* accepts clients of a unix domain socket one by one, lines of each are answered as with Serve */
+    void ServeSocket(const std::string& socket_path);
+
+    /* answer to one line without line breaks, errors are answered with error_message */
+    std::string ProcessLine(std::string_view line);
+
+private:
+    void LoadBase(std::string_view file_name);
+
+    /* true if base_file_name_ is not the file that was loaded anymore */
+    bool IsBaseChanged() const;
+
+    std::unique_ptr<TransportCatalogue> catalogue_;
+    std::unique_ptr<MapRenderer> renderer_;
+    std::unique_ptr<RequestHandler> request_handler_;
+    std::string base_file_name_;
+    std::optional<io::FileVersion> base_file_version_;
+};
+
+} // namespace TC
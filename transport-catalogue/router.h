@@ -1,11 +1,15 @@
 #pragma once
 
 #include "graph.h"
+#include "routes_matrix.h"
+#include "routing_engine.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -14,76 +18,105 @@
 
 namespace graph {
 
+// all-pairs Floyd–Warshall engine: O(V^3) build, O(V^2) memory, route lookups without search.
+// Routes are kept in RoutesMatrix, so weights have to fit into 32 bits below the sentinel
 template <typename Weight>
-class Router {
+class Router : public RoutingEngine<Weight> {
 
 public:
-    struct RouteInternalData;
     using Graph = DirectedWeightedGraph<Weight>;
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    using RouteInfo = typename RoutingEngine<Weight>::RouteInfo;
+    using RoutesInternalData = RoutesMatrix;
 
     Router(const Graph& graph);
 
-    Router(const Graph& graph, RoutesInternalData& routes_internal_data);
+    /* same matrix built by blocked Floyd–Warshall, tiles of every phase are relaxed on thread_pool */
+    Router(const Graph& graph, parallel::ThreadPool& thread_pool);
 
-    struct RouteInfo {
-        Weight weight;
-        std::vector<EdgeId> edges;
-    };
+    Router(const Graph& graph, RoutesInternalData& routes_internal_data);
 
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
 
     const RoutesInternalData& GetRoutesInternalData() const{
         return routes_internal_data_;
     }
 
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
-    };
-
 private:
+    using Cell = RoutesMatrix::Cell;
+
+    static Cell ToCell(Weight weight) {
+        if (weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        if (!(weight < static_cast<Weight>(RoutesMatrix::UNREACHABLE))) {
+            throw std::overflow_error("Route weight does not fit into routes matrix");
+        }
+        return static_cast<Cell>(weight);
+    }
+
+    /* sum of two stored weights, throws if the route exists but can't be stored */
+    static uint64_t AddWeights(Cell lhs, Cell rhs, Cell current) {
+        const uint64_t sum = uint64_t{lhs} + rhs;
+        if (current == RoutesMatrix::UNREACHABLE && sum >= RoutesMatrix::UNREACHABLE) {
+            throw std::overflow_error("Route weight does not fit into routes matrix");
+        }
+        return sum;
+    }
 
     void InitializeRoutesInternalData(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+            Cell* weights = routes_internal_data_.GetWeights(vertex);
+            Cell* prev_edges = routes_internal_data_.GetPrevEdges(vertex);
+            weights[vertex] = 0;
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
-                    throw std::domain_error("Edges' weights should be non-negative");
-                }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const Cell weight = ToCell(edge.weight);
+                if (weights[edge.to] == RoutesMatrix::UNREACHABLE || weights[edge.to] > weight) {
+                    weights[edge.to] = weight;
+                    prev_edges[edge.to] = static_cast<Cell>(edge_id);
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
-        }
-    }
-
     void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
+        const Cell* through_weights = routes_internal_data_.GetWeights(vertex_through);
+        const Cell* through_edges = routes_internal_data_.GetPrevEdges(vertex_through);
         for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                    }
+            Cell* from_weights = routes_internal_data_.GetWeights(vertex_from);
+            Cell* from_edges = routes_internal_data_.GetPrevEdges(vertex_from);
+            const Cell weight_to_through = from_weights[vertex_through];
+            if (weight_to_through == RoutesMatrix::UNREACHABLE) {
+                continue;
+            }
+            for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
+                if (through_weights[vertex_to] == RoutesMatrix::UNREACHABLE) {
+                    continue;
+                }
+                const uint64_t candidate_weight = AddWeights(weight_to_through, through_weights[vertex_to],
+                                                             from_weights[vertex_to]);
+                if (candidate_weight < from_weights[vertex_to]) {
+                    from_weights[vertex_to] = static_cast<Cell>(candidate_weight);
+                    from_edges[vertex_to] = through_edges[vertex_to] != RoutesMatrix::NO_EDGE
+                                          ? through_edges[vertex_to] : from_edges[vertex_through];
                 }
             }
         }
     }
 
-    Weight ZERO_WEIGHT{};
+    // edge counts of the blocked build, row-major as the matrix. Equal weight routes are compared by them:
+    // blocked phases relax in another order than the plain loop, and without a strict order
+    // zero weight cycles could make prev edges point at each other
+    using Hops = std::vector<uint32_t>;
+
+    static constexpr size_t blockSize = 64;
+
+    /* relaxes tile (block_from, block_to) through every vertex of block_through */
+    static void RelaxBlock(RoutesMatrix& matrix, Hops& hops, size_t block_from, size_t block_to, size_t block_through);
+
+    void BuildBlocked(const Graph& graph, parallel::ThreadPool& thread_pool);
+
     const Graph& graph_;
     RoutesInternalData routes_internal_data_;
 };
@@ -91,8 +124,7 @@ private:
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , routes_internal_data_(graph.GetVertexCount())
 {
     InitializeRoutesInternalData(graph);
 
@@ -103,31 +135,151 @@ Router<Weight>::Router(const Graph& graph)
     
 }
 
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, parallel::ThreadPool& thread_pool)
+    : graph_(graph)
+{
+    BuildBlocked(graph, thread_pool);
+}
+
+template <typename Weight>
+void Router<Weight>::RelaxBlock(RoutesMatrix& matrix, Hops& hops, size_t block_from, size_t block_to,
+                                size_t block_through) {
+    const size_t size = matrix.GetVertexCount();
+    const size_t from_end = std::min(size, (block_from + 1) * blockSize);
+    const size_t to_begin = block_to * blockSize;
+    const size_t to_end = std::min(size, to_begin + blockSize);
+    const size_t through_end = std::min(size, (block_through + 1) * blockSize);
+
+    for (size_t through = block_through * blockSize; through < through_end; ++through) {
+        const Cell* through_weights = matrix.GetWeights(through);
+        const Cell* through_edges = matrix.GetPrevEdges(through);
+        const uint32_t* through_hops = &hops[through * size];
+
+        for (size_t from = block_from * blockSize; from < from_end; ++from) {
+            Cell* from_weights = matrix.GetWeights(from);
+            Cell* from_edges = matrix.GetPrevEdges(from);
+            uint32_t* from_hops = &hops[from * size];
+
+            const Cell weight_to_through = from_weights[through];
+            if (weight_to_through == RoutesMatrix::UNREACHABLE) {
+                continue;
+            }
+            const uint32_t hops_to_through = from_hops[through];
+            for (size_t to = to_begin; to < to_end; ++to) {
+                if (through_weights[to] == RoutesMatrix::UNREACHABLE) {
+                    continue;
+                }
+                const uint64_t candidate_weight = AddWeights(weight_to_through, through_weights[to], from_weights[to]);
+                const uint32_t candidate_hops = hops_to_through + through_hops[to];
+                if (candidate_weight < from_weights[to]
+                    || (candidate_weight == from_weights[to] && candidate_hops < from_hops[to])) {
+                    from_weights[to] = static_cast<Cell>(candidate_weight);
+                    from_hops[to] = candidate_hops;
+                    from_edges[to] = through_edges[to] != RoutesMatrix::NO_EDGE ? through_edges[to]
+                                                                                : from_edges[through];
+                }
+            }
+        }
+    }
+}
+
+template <typename Weight>
+void Router<Weight>::BuildBlocked(const Graph& graph, parallel::ThreadPool& thread_pool) {
+    const size_t vertex_count = graph.GetVertexCount();
+
+    RoutesMatrix matrix(vertex_count);
+    Hops hops(vertex_count * vertex_count, 0);
+
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        Cell* weights = matrix.GetWeights(vertex);
+        Cell* prev_edges = matrix.GetPrevEdges(vertex);
+        weights[vertex] = 0;
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const auto& edge = graph.GetEdge(edge_id);
+            const Cell weight = ToCell(edge.weight);
+            if (edge.to == vertex) {
+                continue;
+            }
+            if (weights[edge.to] == RoutesMatrix::UNREACHABLE || weights[edge.to] > weight) {
+                weights[edge.to] = weight;
+                hops[vertex * vertex_count + edge.to] = 1;
+                prev_edges[edge.to] = static_cast<Cell>(edge_id);
+            }
+        }
+    }
+
+    const size_t block_count = (vertex_count + blockSize - 1) / blockSize;
+
+    for (size_t block_through = 0; block_through < block_count; ++block_through) {
+        // phase 1: diagonal block depends only on itself
+        RelaxBlock(matrix, hops, block_through, block_through, block_through);
+
+        // phase 2: blocks in the row and the column of the diagonal one
+        thread_pool.ParallelFor(2 * block_count, [&](size_t task) {
+            const size_t block = task / 2;
+            if (block == block_through) {
+                return;
+            }
+            if (task % 2) {
+                RelaxBlock(matrix, hops, block_through, block, block_through);
+            } else {
+                RelaxBlock(matrix, hops, block, block_through, block_through);
+            }
+        });
+
+        // phase 3: the rest, one task per block row
+        thread_pool.ParallelFor(block_count, [&](size_t block_from) {
+            if (block_from == block_through) {
+                return;
+            }
+            for (size_t block_to = 0; block_to < block_count; ++block_to) {
+                if (block_to != block_through) {
+                    RelaxBlock(matrix, hops, block_from, block_to, block_through);
+                }
+            }
+        });
+    }
+
+    routes_internal_data_ = std::move(matrix);
+}
+
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph, RoutesInternalData& routes_internal_data)
     : graph_(graph)
     , routes_internal_data_(std::move(routes_internal_data)){
+    if (routes_internal_data_.GetVertexCount() != graph_.GetVertexCount()) {
+        throw std::invalid_argument("Routes matrix doesn't match the graph");
+    }
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+    if (from >= routes_internal_data_.GetVertexCount() || to >= routes_internal_data_.GetVertexCount()) {
+        throw std::out_of_range("Vertex is out of routes matrix");
+    }
+    const Cell weight = routes_internal_data_.GetWeights(from)[to];
+    if (weight == RoutesMatrix::UNREACHABLE) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
+    const Cell* prev_edges = routes_internal_data_.GetPrevEdges(from);
     std::vector<EdgeId> edges;
-    
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+
+    // a mapped matrix is only read here, so its edge ids are checked as they are followed:
+    // a route has fewer edges than there are vertices
+    for (Cell edge_id = prev_edges[to];
+         edge_id != RoutesMatrix::NO_EDGE;
+         edge_id = prev_edges[graph_.GetEdge(edge_id).from])
     {
-        edges.push_back(*edge_id);
+        if (edge_id >= graph_.GetEdgeCount() || edges.size() >= routes_internal_data_.GetVertexCount()) {
+            throw std::runtime_error("Routes matrix is corrupted");
+        }
+        edges.push_back(edge_id);
     }
     std::reverse(edges.begin(), edges.end());
 
-    return RouteInfo{weight, std::move(edges)};
+    return RouteInfo{static_cast<Weight>(weight), std::move(edges)};
 }
 
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "graph.h"
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace graph {
+
+/* all-pairs routes table: row-major weights plane followed by row-major prev edges plane,
+   both kept in one contiguous block of 32-bit cells. Missing values are sentinels
+   instead of std::optional, so a cell costs 8 bytes and a row is a plain array.
+   The block is either owned or a read-only view (e.g. into a mapped base file) */
+class RoutesMatrix {
+
+public:
+    using Cell = uint32_t;
+
+    static constexpr Cell UNREACHABLE = std::numeric_limits<Cell>::max();
+    static constexpr Cell NO_EDGE = std::numeric_limits<Cell>::max();
+
+    RoutesMatrix() = default;
+
+    /* every route is unreachable, no prev edges */
+    explicit RoutesMatrix(size_t vertex_count)
+        : vertex_count_(vertex_count)
+        , owned_cells_(GetCellCount(vertex_count), UNREACHABLE){
+    }
+
+    /* view over GetCellCount(vertex_count) cells, storage keeps them alive */
+    RoutesMatrix(size_t vertex_count, const Cell* cells, std::shared_ptr<const void> storage)
+        : vertex_count_(vertex_count)
+        , view_cells_(cells)
+        , storage_(std::move(storage)){
+    }
+
+    static size_t GetCellCount(size_t vertex_count){
+        return 2 * vertex_count * vertex_count;
+    }
+
+    size_t GetVertexCount() const{
+        return vertex_count_;
+    }
+
+    bool IsView() const{
+        return view_cells_ != nullptr;
+    }
+
+    /* mutable rows exist for owned matrices only */
+    Cell* GetWeights(VertexId from){
+        assert(!IsView());
+        return owned_cells_.data() + from * vertex_count_;
+    }
+
+    const Cell* GetWeights(VertexId from) const{
+        return GetCells() + from * vertex_count_;
+    }
+
+    Cell* GetPrevEdges(VertexId from){
+        assert(!IsView());
+        return owned_cells_.data() + (vertex_count_ + from) * vertex_count_;
+    }
+
+    const Cell* GetPrevEdges(VertexId from) const{
+        return GetCells() + (vertex_count_ + from) * vertex_count_;
+    }
+
+    /* whole table, weights plane first */
+    const Cell* GetCells() const{
+        return IsView() ? view_cells_ : owned_cells_.data();
+    }
+
+private:
+    size_t vertex_count_ = 0;
+    std::vector<Cell> owned_cells_;
+    const Cell* view_cells_ = nullptr;
+    std::shared_ptr<const void> storage_;
+};
+
+}  // namespace graph
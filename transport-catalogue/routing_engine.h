@@ -0,0 +1,25 @@
+#pragma once
+
+#include "graph.h"
+
+#include <optional>
+#include <vector>
+
+namespace graph {
+
+/* common contract for every shortest path engine over DirectedWeightedGraph */
+template <typename Weight>
+class RoutingEngine {
+
+public:
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+    virtual ~RoutingEngine() {};
+};
+
+}  // namespace graph
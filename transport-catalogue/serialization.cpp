@@ -1,84 +1,119 @@
 #include "serialization.h"
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
 namespace TC {
 
         namespace detail {
 
-            inline TC_PROTO::Stop* StopToProto(const Stop& stop){
-                TC_PROTO::Stop* proto_stop = new TC_PROTO::Stop();
-                proto_stop->set_id(stop.GetIndex());
-                proto_stop->set_name(stop.GetNameStr());
-                proto_stop->set_latitude(stop.getCoordinates().lat);
-                proto_stop->set_longitude(stop.getCoordinates().lng);
+            // last bytes of a base with a routes section. The section itself is
+            // RoutesMatrix cells in host byte order, 8-byte aligned inside the file
+            struct RoutesSectionTrailer {
+                uint64_t message_size;
+                uint64_t section_offset;
+                uint64_t vertex_count;
+                char magic[8];
+            };
 
-                return proto_stop;
-            }
+            constexpr char routesSectionMagic[8] = {'T', 'C', 'R', 'O', 'U', 'T', 'E', 'S'};
 
-            inline TC_PROTO::Bus* BusToProto(const Bus& bus){
-                TC_PROTO::Bus* proto_bus = new TC_PROTO::Bus();
+            inline std::optional<RoutesSectionTrailer> FindRoutesSection(const io::MappedFile& base_file){
+                if(base_file.GetSize() < sizeof(RoutesSectionTrailer)){
+                    return std::nullopt;
+                }
 
-                proto_bus->set_name(bus.GetNameStr());
-                proto_bus->set_is_roundtrip(bus.IsCircular());
+                RoutesSectionTrailer trailer;
+                std::memcpy(&trailer, base_file.GetData() + base_file.GetSize() - sizeof(trailer), sizeof(trailer));
 
-                for(const Stop* stop : bus.GetStops()){
-                    proto_bus->mutable_stops()->Add(stop->GetIndex());
+                if(std::memcmp(trailer.magic, routesSectionMagic, sizeof(routesSectionMagic)) != 0){
+                    return std::nullopt;
                 }
 
-                return proto_bus;
+                if(trailer.vertex_count > base_file.GetSize()){
+                    throw std::runtime_error("Routes section of the base is corrupted");
+                }
 
+                const uint64_t section_size = graph::RoutesMatrix::GetCellCount(trailer.vertex_count) * sizeof(graph::RoutesMatrix::Cell);
+                if(trailer.message_size > trailer.section_offset
+                    || trailer.section_offset % alignof(graph::RoutesMatrix::Cell) != 0
+                    || trailer.section_offset + section_size + sizeof(trailer) != base_file.GetSize()){
+                    throw std::runtime_error("Routes section of the base is corrupted");
+                }
+
+                return trailer;
+            }
+
+            // conversions below fill messages in place, they and their parts live on the caller's arena
+            inline void StopToProto(const Stop& stop, TC_PROTO::Stop& proto_stop){
+                proto_stop.set_id(stop.GetIndex());
+                proto_stop.set_name(stop.GetNameStr());
+                proto_stop.set_latitude(stop.getCoordinates().lat);
+                proto_stop.set_longitude(stop.getCoordinates().lng);
             }
 
-            inline TC_PROTO::Distance* StopsDistanceToProto(const std::pair<TC::Stop *, TC::Stop *>& stops, uint32_t distance){
-                TC_PROTO::Distance* proto_dist = new TC_PROTO::Distance();
+            inline void BusToProto(const Bus& bus, TC_PROTO::Bus& proto_bus){
+                proto_bus.set_name(bus.GetNameStr());
+                proto_bus.set_is_roundtrip(bus.IsCircular());
 
-                proto_dist->set_start(stops.first->GetIndex());
-                proto_dist->set_end(stops.second->GetIndex());
-                proto_dist->set_distance(distance);
+                const auto& stats = bus.GetStats();
+                proto_bus.set_route_length(stats.length_traveled);
+                proto_bus.set_stop_count(stats.stops_count);
+                proto_bus.set_unique_stop_count(stats.stops_unique_count);
+                proto_bus.set_length_direct(stats.length_direct);
+                proto_bus.set_curvature(stats.curvature);
 
-                return proto_dist;
+                auto* proto_stops = proto_bus.mutable_stops();
+                proto_stops->Reserve(static_cast<int>(bus.GetStops().size()));
+                for(const Stop* stop : bus.GetStops()){
+                    proto_stops->Add(stop->GetIndex());
+                }
             }
 
-            inline TC_PROTO::Point* PointToProto(const svg::Point& point){
-                TC_PROTO::Point* result = new TC_PROTO::Point();
-                result->set_x(point.x);
-                result->set_y(point.y);
-                return result;
+            inline void StopsDistanceToProto(const std::pair<TC::Stop *, TC::Stop *>& stops, uint32_t distance, TC_PROTO::Distance& proto_dist){
+                proto_dist.set_start(stops.first->GetIndex());
+                proto_dist.set_end(stops.second->GetIndex());
+                proto_dist.set_distance(distance);
             }
 
-            inline TC_PROTO::Color* ColorToProto(const svg::Color& color){
-                TC_PROTO::Color* result = new TC_PROTO::Color();
+            inline void PointToProto(const svg::Point& point, TC_PROTO::Point& result){
+                result.set_x(point.x);
+                result.set_y(point.y);
+            }
+
+            inline void ColorToProto(const svg::Color& color, TC_PROTO::Color& result){
 
                 if(std::holds_alternative<std::monostate>(color)){
-                    result->set_none(true);
+                    result.set_none(true);
                 } else
                 if(std::holds_alternative<svg::Rgb>(color)){
                     const auto& rgb = std::get<svg::Rgb>(color);
-                    TC_PROTO::Rgb* rgb_proto = new TC_PROTO::Rgb();
+                    TC_PROTO::Rgb* rgb_proto = result.mutable_rgb();
                     rgb_proto->set_red(rgb.red);
                     rgb_proto->set_green(rgb.green);
                     rgb_proto->set_blue(rgb.blue);
-
-                    result->set_allocated_rgb(rgb_proto);
                 } else
                 if (std::holds_alternative<svg::Rgba>(color)){
                     const auto& rgba = std::get<svg::Rgba>(color);
-                    TC_PROTO::Rgba* rgba_proto = new TC_PROTO::Rgba();
+                    TC_PROTO::Rgba* rgba_proto = result.mutable_rgba();
                     rgba_proto->set_red(rgba.red);
                     rgba_proto->set_green(rgba.green);
                     rgba_proto->set_blue(rgba.blue);
                     rgba_proto->set_opacity(rgba.opacity);
-
-                    result->set_allocated_rgba(rgba_proto);
                 } else
                 if(std::holds_alternative<std::string>(color)){
                     const auto& string_color = std::get<std::string>(color);
-                    result->set_string_color(string_color);
+                    result.set_string_color(string_color);
                 } 
                 else{
-                    result->set_none(true);
+                    result.set_none(true);
                 }
-
-                return result;
             }
 
             inline svg::Point ProtoToPoint(const TC_PROTO::Point& proto_point){
@@ -115,107 +150,371 @@ namespace TC {
 
                 return result;
             }
+
+            inline TC_PROTO::RouterType RouterTypeToProto(router_type_t type){
+                switch(type){
+                    case router_type_t::DIJKSTRA:
+                        return TC_PROTO::DIJKSTRA;
+                    case router_type_t::CONTRACTION_HIERARCHY:
+                        return TC_PROTO::CONTRACTION_HIERARCHY;
+                    case router_type_t::ASTAR:
+                        return TC_PROTO::ASTAR;
+                    default:
+                        return TC_PROTO::ALL_PAIRS;
+                }
+            }
+
+            inline router_type_t ProtoToRouterType(TC_PROTO::RouterType type){
+                switch(type){
+                    case TC_PROTO::DIJKSTRA:
+                        return router_type_t::DIJKSTRA;
+                    case TC_PROTO::CONTRACTION_HIERARCHY:
+                        return router_type_t::CONTRACTION_HIERARCHY;
+                    case TC_PROTO::ASTAR:
+                        return router_type_t::ASTAR;
+                    default:
+                        return router_type_t::ALL_PAIRS;
+                }
+            }
+
+            // names of a flat base in the order they are added
+            class FlatNames {
+            public:
+                FlatBase::Name Add(std::string_view name){
+                    if(chars_.size() + name.size() > std::numeric_limits<uint32_t>::max()){
+                        throw std::runtime_error("Names don't fit in the base");
+                    }
+                    const FlatBase::Name result{static_cast<uint32_t>(chars_.size()), static_cast<uint32_t>(name.size())};
+                    chars_.insert(chars_.end(), name.begin(), name.end());
+                    return result;
+                }
+
+                const std::vector<char>& GetChars() const{
+                    return chars_;
+                }
+
+            private:
+                std::vector<char> chars_;
+            };
+
+            [[noreturn]] inline void ThrowCorruptedBase(){
+                throw std::runtime_error("Base file is corrupted");
+            }
+
+            // every edge of the graph has its info, route answers look stops and buses up by what it says.
+            // Only SPAN and BOARD edges leave stops, so a route from a stop always starts with a line.
+            // Infos past the edges are spare slots of the router and are never read
+            inline void CheckEdgeInfos(const TransportRouter& transport_router, const std::vector<TransportRouter::EdgeInfo>& edge_infos){
+                const auto& graph = transport_router.GetGraph();
+                const size_t stop_count = transport_router.GetCatalogue().GetStops().size();
+                const size_t bus_count = transport_router.GetCatalogue().GetBuses().size();
+
+                if(edge_infos.size() < graph.GetEdgeCount()){
+                    ThrowCorruptedBase();
+                }
+                for(graph::EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id){
+                    const auto& edge_info = edge_infos[edge_id];
+                    const bool leaves_stop = edge_info.type == TransportRouter::EdgeType::SPAN
+                                            || edge_info.type == TransportRouter::EdgeType::BOARD;
+                    if(static_cast<unsigned>(edge_info.type) > static_cast<unsigned>(TransportRouter::EdgeType::ALIGHT)
+                        || edge_info.from >= stop_count || edge_info.to >= stop_count
+                        || edge_info.bus_id >= bus_count
+                        || leaves_stop != (graph.GetEdge(edge_id).from < stop_count)){
+                        ThrowCorruptedBase();
+                    }
+                }
+            }
+
+            // the hierarchy checks its shortcuts against the graph, a mismatch means the base is damaged
+            inline std::unique_ptr<graph::ContractionHierarchy<TransportRouter::Weight>> MakeStoredHierarchy(const TransportRouter& transport_router
+                                    , std::vector<size_t>& ranks, std::vector<graph::ContractionHierarchy<TransportRouter::Weight>::Shortcut>& shortcuts){
+                try{
+                    return std::make_unique<graph::ContractionHierarchy<TransportRouter::Weight>>(transport_router.GetGraph(), ranks, shortcuts);
+                } catch(const std::invalid_argument&){
+                    ThrowCorruptedBase();
+                }
+            }
+
+            // the graph always has the stop vertices, and no more vertices than the model of the settings
+            // needs for the catalogue. Checked before anything is allocated from the stored count
+            inline size_t GetGraphVertexCount(const TransportRouter& transport_router, size_t stored_vertex_count){
+                if(stored_vertex_count > transport_router.GetModelVertexCount()){
+                    ThrowCorruptedBase();
+                }
+                // bases written before vertex_count was stored have stop vertices only
+                return std::max(stored_vertex_count, transport_router.GetCatalogue().GetStops().size());
+            }
+
+            inline FlatBase::Color ColorToFlat(const svg::Color& color, FlatNames& names){
+                FlatBase::Color result{};
+
+                if(std::holds_alternative<svg::Rgb>(color)){
+                    const auto& rgb = std::get<svg::Rgb>(color);
+                    result.type = FlatBase::ColorType::RGB;
+                    result.red = rgb.red;
+                    result.green = rgb.green;
+                    result.blue = rgb.blue;
+                } else
+                if(std::holds_alternative<svg::Rgba>(color)){
+                    const auto& rgba = std::get<svg::Rgba>(color);
+                    result.type = FlatBase::ColorType::RGBA;
+                    result.red = rgba.red;
+                    result.green = rgba.green;
+                    result.blue = rgba.blue;
+                    result.opacity = rgba.opacity;
+                } else
+                if(std::holds_alternative<std::string>(color)){
+                    result.type = FlatBase::ColorType::STRING;
+                    result.name = names.Add(std::get<std::string>(color));
+                } else {
+                    result.type = FlatBase::ColorType::NONE;
+                }
+
+                return result;
+            }
+
+            inline svg::Color FlatToColor(const FlatBase::Color& color, const FlatBase::Reader& reader){
+                switch(color.type){
+                    case FlatBase::ColorType::RGB:
+                        return svg::Rgb{color.red, color.green, color.blue};
+                    case FlatBase::ColorType::RGBA:
+                        return svg::Rgba{color.red, color.green, color.blue, color.opacity};
+                    case FlatBase::ColorType::STRING:
+                        return std::string(reader.GetName(color.name));
+                    default:
+                        return std::monostate{};
+                }
+            }
+
+            // the router field of a protobuf base is written as many TransportRouter messages,
+            // the parser merges them, so one of them is never built whole
+            constexpr size_t routerChunkItems = 1 << 16;
+            constexpr size_t routerChunkArenaBlock = 1 << 22;    // about what a parsed chunk takes
+            constexpr uint32_t lengthDelimitedWireType = 2;
+
+            template <typename Message>
+            void WriteBusManagerField(google::protobuf::io::CodedOutputStream& output, int field_number, const Message& message){
+                const size_t size = message.ByteSizeLong();
+                if(size > INT_MAX){
+                    throw std::runtime_error("Base message is too big");
+                }
+                output.WriteTag(static_cast<uint32_t>(field_number) << 3 | lengthDelimitedWireType);
+                output.WriteVarint32(static_cast<uint32_t>(size));
+                message.SerializeWithCachedSizes(&output);
+            }
+
+            // add_items(chunk, begin, end) replaces items of the chunk with items [begin, end).
+            // It clears the repeated field it fills rather than the chunk: Clear() of a message on
+            // an arena drops its sub-messages into the arena, a cleared repeated field keeps its
+            // items for the next chunk
+            template <typename AddItems>
+            void WriteRouterChunks(google::protobuf::io::CodedOutputStream& output, google::protobuf::Arena& arena
+                                    , size_t item_count, AddItems add_items){
+                auto& chunk = *google::protobuf::Arena::CreateMessage<TC_PROTO::TransportRouter>(&arena);
+                for(size_t begin = 0; begin < item_count; begin += routerChunkItems){
+                    add_items(chunk, begin, std::min(item_count, begin + routerChunkItems));
+                    WriteBusManagerField(output, TC_PROTO::BusManager::kTransportRouterFieldNumber, chunk);
+                }
+            }
+
+            template <typename Message>
+            void MergeBusManagerField(Message& message, const char* data, size_t size){
+                google::protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data), static_cast<int>(size));
+                if(!message.MergeFromCodedStream(&input) || !input.ConsumedEntireMessage()){
+                    throw std::runtime_error("Can't parse the base");
+                }
+            }
+
+            // the router field of a protobuf base, collected from every message it is written as
+            struct ProtoRouterParts {
+                TC_PROTO::Settings settings;
+                size_t vertex_count = 0;
+                std::vector<graph::Edge<TransportRouter::Weight>> edges;
+                std::vector<TransportRouter::EdgeInfo> edge_infos;
+                std::vector<size_t> ranks;
+                std::vector<graph::ContractionHierarchy<TransportRouter::Weight>::Shortcut> shortcuts;
+                std::vector<uint32_t> routes_matrix;
+                google::protobuf::RepeatedPtrField<TC_PROTO::RouteInternalDataList> routes_internal_data;
+            };
+
+            // same result as merging the chunk into one TransportRouter message
+            inline void AddRouterChunk(ProtoRouterParts& parts, const TC_PROTO::TransportRouter& chunk){
+                if(chunk.has_settings()){
+                    parts.settings.MergeFrom(chunk.settings());
+                }
+                if(chunk.graph().vertex_count()){
+                    parts.vertex_count = chunk.graph().vertex_count();
+                }
+
+                for(const auto& proto_edge : chunk.graph().edges()){
+                    parts.edges.push_back({proto_edge.from(), proto_edge.to(), proto_edge.weight()});
+                }
+
+                for(const auto& proto_edge_info : chunk.edge_infos()){
+                    TransportRouter::EdgeInfo edge_info;
+                    edge_info.bus_id = proto_edge_info.bus_id();
+                    edge_info.distance_m = proto_edge_info.distance_m();
+                    edge_info.from = proto_edge_info.from();
+                    edge_info.to = proto_edge_info.to();
+                    edge_info.span_count = proto_edge_info.span_count();
+                    edge_info.type = static_cast<TransportRouter::EdgeType>(proto_edge_info.type());
+                    parts.edge_infos.push_back(std::move(edge_info));
+                }
+
+                const auto& proto_ch = chunk.contraction_hierarchy();
+                parts.ranks.insert(parts.ranks.end(), proto_ch.ranks().begin(), proto_ch.ranks().end());
+                for(const auto& proto_shortcut : proto_ch.shortcuts()){
+                    parts.shortcuts.push_back({proto_shortcut.from()
+                                            , proto_shortcut.to()
+                                            , proto_shortcut.weight()
+                                            , proto_shortcut.first_edge()
+                                            , proto_shortcut.second_edge()});
+                }
+
+                parts.routes_matrix.insert(parts.routes_matrix.end(), chunk.routes_matrix().begin(), chunk.routes_matrix().end());
+
+                // older bases have these in their only router message, it's on the chunk's arena
+                parts.routes_internal_data.MergeFrom(chunk.routes_internal_data());
+            }
     }
 
-    TC_PROTO::RenderSettings* RenderSettingsToProto(const map_settings_t& settings){
+    void RenderSettingsToProto(const map_settings_t& settings, TC_PROTO::RenderSettings& settings_proto){
         using namespace detail; 
 
-        TC_PROTO::RenderSettings* settings_proto = new TC_PROTO::RenderSettings();
-
-        settings_proto->set_width(settings.width);
-        settings_proto->set_height(settings.height);
-        settings_proto->set_padding(settings.padding);
-        settings_proto->set_line_width(settings.line_width);
-        settings_proto->set_stop_radius(settings.stop_radius);
-        settings_proto->set_bus_label_font_size(settings.bus_label_font_size);
-        settings_proto->set_allocated_bus_label_offset(PointToProto(settings.bus_label_offset));
-        settings_proto->set_stop_label_font_size(settings.stop_label_font_size);
-        settings_proto->set_allocated_stop_label_offset(PointToProto(settings.stop_label_offset));
-        settings_proto->set_allocated_underlayer_color(ColorToProto(settings.underlayer_color));
-        settings_proto->set_underlayer_width(settings.underlayer_width);
-        
+        settings_proto.set_width(settings.width);
+        settings_proto.set_height(settings.height);
+        settings_proto.set_padding(settings.padding);
+        settings_proto.set_line_width(settings.line_width);
+        settings_proto.set_stop_radius(settings.stop_radius);
+        settings_proto.set_bus_label_font_size(settings.bus_label_font_size);
+        PointToProto(settings.bus_label_offset, *settings_proto.mutable_bus_label_offset());
+        settings_proto.set_stop_label_font_size(settings.stop_label_font_size);
+        PointToProto(settings.stop_label_offset, *settings_proto.mutable_stop_label_offset());
+        ColorToProto(settings.underlayer_color, *settings_proto.mutable_underlayer_color());
+        settings_proto.set_underlayer_width(settings.underlayer_width);
+
+        auto* proto_palette = settings_proto.mutable_color_palette();
+        proto_palette->Reserve(static_cast<int>(settings.color_palette.size()));
         for(const auto& color : settings.color_palette){
-            settings_proto->mutable_color_palette()->AddAllocated(ColorToProto(color));
+            ColorToProto(color, *proto_palette->Add());
         }
-
-        return settings_proto;
-
     }
 
-    TC_PROTO::TransportCatalogue* TransportCatalogueToProto(const TransportCatalogue& catalogue){
-        TC_PROTO::TransportCatalogue* proto_catalogue = new TC_PROTO::TransportCatalogue();
-
+    void TransportCatalogueToProto(const TransportCatalogue& catalogue, TC_PROTO::TransportCatalogue& proto_catalogue){
         using namespace detail;
 
+        auto* proto_stops = proto_catalogue.mutable_stops();
+        proto_stops->Reserve(static_cast<int>(catalogue.GetStops().size()));
         for(const auto& stop : catalogue.GetStops()){
-            proto_catalogue->mutable_stops()->AddAllocated(StopToProto(stop));
+            StopToProto(stop, *proto_stops->Add());
         }
 
+        auto* proto_buses = proto_catalogue.mutable_buses();
+        proto_buses->Reserve(static_cast<int>(catalogue.GetBuses().size()));
         for(const auto& bus : catalogue.GetBuses()){
-            proto_catalogue->mutable_buses()->AddAllocated(BusToProto(bus));
+            BusToProto(bus, *proto_buses->Add());
         }
 
+        auto* proto_distances = proto_catalogue.mutable_distances();
+        proto_distances->Reserve(static_cast<int>(catalogue.GetStopsDistances().size()));
         for(const auto& [stops, dist] : catalogue.GetStopsDistances()){
-            proto_catalogue->mutable_distances()->AddAllocated(StopsDistanceToProto(stops, dist));
+            StopsDistanceToProto(stops, dist, *proto_distances->Add());
         }
-
-       return proto_catalogue;
-
     }
 
-    TC_PROTO::TransportRouter* TransportRouterToProto(const TransportRouter& transport_router){
+    void WriteBusManager(const TransportCatalogue& catalogue, const map_settings_t& render_settings, const TransportRouter& transport_router, std::ostream& out_stream){
         using namespace detail;
 
-        TC_PROTO::TransportRouter* proto_router = new TC_PROTO::TransportRouter();
+        {
+            google::protobuf::io::OstreamOutputStream stream(&out_stream);
+            google::protobuf::io::CodedOutputStream output(&stream);
 
-        proto_router->mutable_settings()->set_bus_velocity_kmh(transport_router.GetSettings().bus_velocity_kmh);
-        proto_router->mutable_settings()->set_bus_wait_time_min(transport_router.GetSettings().bus_wait_time_min);
+            // messages are freed at once with the arena, router chunks reuse theirs
+            google::protobuf::Arena arena;
 
-        for(const auto& edge : transport_router.GetGraph().GetEdges()){
+            auto* proto_catalogue = google::protobuf::Arena::CreateMessage<TC_PROTO::TransportCatalogue>(&arena);
+            TransportCatalogueToProto(catalogue, *proto_catalogue);
+            WriteBusManagerField(output, TC_PROTO::BusManager::kTransportCatalogueFieldNumber, *proto_catalogue);
 
-            TC_PROTO::Edge proto_edge;
+            auto* proto_render_settings = google::protobuf::Arena::CreateMessage<TC_PROTO::RenderSettings>(&arena);
+            RenderSettingsToProto(render_settings, *proto_render_settings);
+            WriteBusManagerField(output, TC_PROTO::BusManager::kRenderSettingsFieldNumber, *proto_render_settings);
 
-            proto_edge.set_from(edge.from);
-            proto_edge.set_to(edge.to);
-            proto_edge.set_weight(edge.weight);
+            auto& proto_router = *google::protobuf::Arena::CreateMessage<TC_PROTO::TransportRouter>(&arena);
 
-            proto_router->mutable_graph()->mutable_edges()->Add(std::move(proto_edge));
-        }
+            proto_router.mutable_settings()->set_bus_velocity_kmh(transport_router.GetSettings().bus_velocity_kmh);
+            proto_router.mutable_settings()->set_bus_wait_time_min(transport_router.GetSettings().bus_wait_time_min);
+            proto_router.mutable_settings()->set_router_type(RouterTypeToProto(transport_router.GetSettings().router_type));
+            proto_router.mutable_settings()->set_graph_model(transport_router.GetSettings().graph_model == graph_model_t::COMPACT
+                                                                ? TC_PROTO::COMPACT
+                                                                : TC_PROTO::COMPLETE);
 
-        for(const auto& routes_internal_data : transport_router.GetRouter().GetRoutesInternalData()){
-            TC_PROTO::RouteInternalDataList proto_list;
-            for(const auto& route_data : routes_internal_data){
-                TC_PROTO::RouteInternalData proto_data;
-                if(route_data){
-                    proto_data.set_empty_data(false);
-                    proto_data.set_weight(route_data->weight);
-                    if(route_data->prev_edge){
-                        proto_data.set_empty_edge(false);
-                        proto_data.set_prev_edge(route_data->prev_edge.value());
-                    } else{
-                        proto_data.set_empty_edge(true);
-                    }
-                    proto_list.mutable_routes_internal_data_list();
-                } else {
-                    proto_data.set_empty_data(true);
+            proto_router.mutable_graph()->set_vertex_count(transport_router.GetGraph().GetVertexCount());
+
+            WriteBusManagerField(output, TC_PROTO::BusManager::kTransportRouterFieldNumber, proto_router);
+
+            const auto& edges = transport_router.GetGraph().GetEdges();
+            WriteRouterChunks(output, arena, edges.size(), [&edges](TC_PROTO::TransportRouter& chunk, size_t begin, size_t end){
+                auto* proto_edges = chunk.mutable_graph()->mutable_edges();
+                proto_edges->Clear();
+                proto_edges->Reserve(static_cast<int>(end - begin));
+                for(size_t i = begin; i < end; ++i){
+                    auto* proto_edge = proto_edges->Add();
+                    proto_edge->set_from(edges[i].from);
+                    proto_edge->set_to(edges[i].to);
+                    proto_edge->set_weight(edges[i].weight);
                 }
-                proto_list.mutable_routes_internal_data_list()->Add(std::move(proto_data));
+            });
+
+            if(const auto* ch_router = dynamic_cast<const graph::ContractionHierarchy<TransportRouter::Weight>*>(&transport_router.GetRouter())){
+                const auto& ranks = ch_router->GetRanks();
+                WriteRouterChunks(output, arena, ranks.size(), [&ranks](TC_PROTO::TransportRouter& chunk, size_t begin, size_t end){
+                    auto* proto_ranks = chunk.mutable_contraction_hierarchy()->mutable_ranks();
+                    proto_ranks->Clear();
+                    proto_ranks->Reserve(static_cast<int>(end - begin));
+                    for(size_t i = begin; i < end; ++i){
+                        proto_ranks->Add(ranks[i]);
+                    }
+                });
+
+                const auto& shortcuts = ch_router->GetShortcuts();
+                WriteRouterChunks(output, arena, shortcuts.size(), [&shortcuts](TC_PROTO::TransportRouter& chunk, size_t begin, size_t end){
+                    auto* proto_shortcuts = chunk.mutable_contraction_hierarchy()->mutable_shortcuts();
+                    proto_shortcuts->Clear();
+                    proto_shortcuts->Reserve(static_cast<int>(end - begin));
+                    for(size_t i = begin; i < end; ++i){
+                        auto* proto_shortcut = proto_shortcuts->Add();
+                        proto_shortcut->set_from(shortcuts[i].from);
+                        proto_shortcut->set_to(shortcuts[i].to);
+                        proto_shortcut->set_weight(shortcuts[i].weight);
+                        proto_shortcut->set_first_edge(shortcuts[i].first_edge);
+                        proto_shortcut->set_second_edge(shortcuts[i].second_edge);
+                    }
+                });
             }
-            proto_router->mutable_routes_internal_data()->Add(std::move(proto_list));
-        }
 
-        for(const auto& edge_info : transport_router.GetEdgeInfos()){
-            TC_PROTO::EdgeInfo proto_edge_info;
-            proto_edge_info.set_bus_id(edge_info.bus_id);
-            proto_edge_info.set_distance_m(edge_info.distance_m);
-            proto_edge_info.set_from(edge_info.from);
-            proto_edge_info.set_to(edge_info.to);
-            proto_edge_info.set_span_count(edge_info.span_count);
+            const auto& edge_infos = transport_router.GetEdgeInfos();
+            WriteRouterChunks(output, arena, edge_infos.size(), [&edge_infos](TC_PROTO::TransportRouter& chunk, size_t begin, size_t end){
+                auto* proto_edge_infos = chunk.mutable_edge_infos();
+                proto_edge_infos->Clear();
+                proto_edge_infos->Reserve(static_cast<int>(end - begin));
+                for(size_t i = begin; i < end; ++i){
+                    auto* proto_edge_info = proto_edge_infos->Add();
+                    proto_edge_info->set_bus_id(edge_infos[i].bus_id);
+                    proto_edge_info->set_distance_m(edge_infos[i].distance_m);
+                    proto_edge_info->set_from(edge_infos[i].from);
+                    proto_edge_info->set_to(edge_infos[i].to);
+                    proto_edge_info->set_span_count(edge_infos[i].span_count);
+                    proto_edge_info->set_type(static_cast<uint32_t>(edge_infos[i].type));
+                }
+            });
 
-            proto_router->mutable_edge_infos()->Add(std::move(proto_edge_info));
+            if(output.HadError()){
+                throw std::runtime_error("Can't write the base");
+            }
         }
 
-        return proto_router;
+        WriteRoutesSection(transport_router, out_stream);
     }
 
     void ProtoToTransportCatalogue(TransportCatalogue& catalogue, const TC_PROTO::TransportCatalogue& proto_catalogue){
@@ -227,15 +526,24 @@ namespace TC {
             catalogue.AddDistance(dist.start(), dist.end(), dist.distance());
         }
 
+        std::vector<size_t> indexed_stops;
         for(const auto& bus : proto_catalogue.buses()){
-            std::vector<size_t> indexed_stops;
-            indexed_stops.reserve(bus.stops_size());
+            indexed_stops.assign(bus.stops().begin(), bus.stops().end());
 
-            for(size_t index : bus.stops()){
-                indexed_stops.push_back(index);
+            if(bus.stop_count() == 0){
+                // written before stats were stored
+                catalogue.AddRoute(bus.name(), indexed_stops, bus.is_roundtrip());
+                continue;
             }
 
-            catalogue.AddRoute(bus.name(), indexed_stops, bus.is_roundtrip());
+            route_stats_t stats;
+            stats.stops_count = bus.stop_count();
+            stats.stops_unique_count = bus.unique_stop_count();
+            stats.length_direct = bus.length_direct();
+            stats.length_traveled = bus.route_length();
+            stats.curvature = bus.curvature();
+
+            catalogue.AddRoute(bus.name(), indexed_stops, bus.is_roundtrip(), stats);
         }
     }
 
@@ -262,80 +570,465 @@ namespace TC {
         }
     }
 
-    void ProtoToTransportRouter(TransportRouter& transport_router, const TC_PROTO::TransportRouter& proto_router){
+    void ProtoToTransportRouter(TransportRouter& transport_router, detail::ProtoRouterParts& proto_router
+                                , graph::RoutesMatrix& routes_section){
+        using namespace detail;
 
-        auto graph = std::make_unique<graph::DirectedWeightedGraph<TransportRouter::Weight>>();
+        routing_settings_t settings;
+        settings.bus_velocity_kmh = proto_router.settings.bus_velocity_kmh();
+        settings.bus_wait_time_min = proto_router.settings.bus_wait_time_min();
+        settings.router_type = ProtoToRouterType(proto_router.settings.router_type());
+        settings.graph_model = proto_router.settings.graph_model() == TC_PROTO::COMPACT
+                                ? graph_model_t::COMPACT
+                                : graph_model_t::COMPLETE;
 
-        for(const auto& proto_edge : proto_router.graph().edges()){
-            graph::Edge<TransportRouter::Weight> edge;
+        transport_router.SetSettings(settings);
 
-            edge.from = proto_edge.from();
-            edge.to = proto_edge.to();
-            edge.weight = proto_edge.weight();
+        const size_t vertex_count = GetGraphVertexCount(transport_router, proto_router.vertex_count);
 
-            graph->AddEdge(edge);
+        if(std::any_of(proto_router.edges.begin(), proto_router.edges.end(), [vertex_count](const auto& edge){
+                return edge.from >= vertex_count || edge.to >= vertex_count;
+            })){
+            ThrowCorruptedBase();
         }
 
-        //auto router = std::make_unique<graph::Router<TransportRouter::Weight>>();
+        transport_router.SetGraph(std::make_unique<graph::DirectedWeightedGraph<TransportRouter::Weight>>(vertex_count, std::move(proto_router.edges)));
 
-        transport_router.SetGraph(std::move(graph));
+        CheckEdgeInfos(transport_router, proto_router.edge_infos);
+        transport_router.SetEdgeInfos(proto_router.edge_infos);
 
-        graph::Router<TransportRouter::Weight>::RoutesInternalData router_data;
+        if(transport_router.GetSettings().router_type == router_type_t::ALL_PAIRS){
+            graph::RoutesMatrix router_data;
 
-        for(const auto& proto_data_list : proto_router.routes_internal_data()){
-            router_data.emplace_back();
-            for(const auto& proto_data : proto_data_list.routes_internal_data_list()){
-                graph::Router<TransportRouter::Weight>::RouteInternalData data;
-                if(proto_data.empty_data()){
-                    router_data.back().push_back(std::nullopt);  
-                } else{
-                    data.weight = proto_data.weight();
-                    if(proto_data.empty_edge()){
-                        data.prev_edge = std::nullopt;
-                    } else {
-                        data.prev_edge = proto_data.prev_edge();
+            if(routes_section.IsView()){
+                router_data = std::move(routes_section);
+            } else
+            if(!proto_router.routes_matrix.empty()){
+                if(proto_router.routes_matrix.size() != graph::RoutesMatrix::GetCellCount(vertex_count)){
+                    throw std::runtime_error("Routes matrix size doesn't match the graph");
+                }
+                router_data = graph::RoutesMatrix(vertex_count);
+                std::copy(proto_router.routes_matrix.begin(), proto_router.routes_matrix.end(),
+                          router_data.GetWeights(0));
+            } else {
+                router_data = graph::RoutesMatrix(vertex_count);
+                // older bases, one message per route
+                for(size_t from = 0; from < std::min<size_t>(vertex_count, proto_router.routes_internal_data.size()); ++from){
+                    const auto& proto_data_list = proto_router.routes_internal_data[from].routes_internal_data_list();
+                    for(size_t to = 0; to < std::min<size_t>(vertex_count, proto_data_list.size()); ++to){
+                        const auto& proto_data = proto_data_list[to];
+                        if(!proto_data.empty_data()){
+                            router_data.GetWeights(from)[to] = proto_data.weight();
+                            if(!proto_data.empty_edge()){
+                                router_data.GetPrevEdges(from)[to] = proto_data.prev_edge();
+                            }
+                        }
                     }
-                    router_data.back().push_back(std::move(data));
                 }
-                
             }
-        }
 
-        auto router = std::make_unique<graph::Router<TransportRouter::Weight>>(transport_router.GetGraph(), router_data);
+            auto router = std::make_unique<graph::Router<TransportRouter::Weight>>(transport_router.GetGraph(), router_data);
         
-        transport_router.SetRouter(std::move(router));
+            transport_router.SetRouter(std::move(router));
+        } else
+        if(transport_router.GetSettings().router_type == router_type_t::CONTRACTION_HIERARCHY){
+            transport_router.SetRouter(MakeStoredHierarchy(transport_router, proto_router.ranks, proto_router.shortcuts));
+        } else {
+            transport_router.BuildRouter();
+        }
+    }
 
-        routing_settings_t settings;
-        settings.bus_velocity_kmh = proto_router.settings().bus_velocity_kmh();
-        settings.bus_wait_time_min = proto_router.settings().bus_wait_time_min();
+    void WriteRoutesSection(const TransportRouter& transport_router, std::ostream& out_stream){
+        using namespace detail;
+
+        // only the all-pairs engine has precomputed data worth storing, the rest are rebuilt or kept in the message
+        const auto* all_pairs_router = dynamic_cast<const graph::Router<TransportRouter::Weight>*>(&transport_router.GetRouter());
+        if(!all_pairs_router){
+            return;
+        }
+
+        const auto& matrix = all_pairs_router->GetRoutesInternalData();
+
+        RoutesSectionTrailer trailer;
+        trailer.message_size = static_cast<uint64_t>(out_stream.tellp());
+        trailer.section_offset = (trailer.message_size + 7) / 8 * 8;
+        trailer.vertex_count = matrix.GetVertexCount();
+        std::memcpy(trailer.magic, routesSectionMagic, sizeof(routesSectionMagic));
+
+        const char padding[8] = {};
+        out_stream.write(padding, trailer.section_offset - trailer.message_size);
+        out_stream.write(reinterpret_cast<const char*>(matrix.GetCells())
+                        , graph::RoutesMatrix::GetCellCount(matrix.GetVertexCount()) * sizeof(graph::RoutesMatrix::Cell));
+        out_stream.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    }
+
+    void DeseriallizeBusManager(TransportCatalogue& catalogue, map_settings_t& render_settings, TransportRouter& transport_router, std::shared_ptr<const io::MappedFile> base_file){
+        using namespace detail;
 
+        const auto trailer = FindRoutesSection(*base_file);
+        const size_t message_size = trailer ? trailer->message_size : base_file->GetSize();
+
+        // catalogue and settings messages are freed at once with the arena. Router chunks are
+        // parsed one by one into an arena of their own that is reset after each of them,
+        // its first block is kept, so a chunk of usual size doesn't allocate at all
+        google::protobuf::Arena arena;
+        auto& proto_catalogue = *google::protobuf::Arena::CreateMessage<TC_PROTO::TransportCatalogue>(&arena);
+        auto& proto_render_settings = *google::protobuf::Arena::CreateMessage<TC_PROTO::RenderSettings>(&arena);
+
+        std::vector<char> chunk_arena_block(routerChunkArenaBlock);
+        google::protobuf::ArenaOptions chunk_arena_options;
+        chunk_arena_options.initial_block = chunk_arena_block.data();
+        chunk_arena_options.initial_block_size = chunk_arena_block.size();
+        google::protobuf::Arena chunk_arena(chunk_arena_options);
+
+        ProtoRouterParts proto_router;
+
+        // fields are parsed one at a time as they follow each other, so the message is never
+        // held whole and may be bigger than protobuf's limit for one. Only its chunks can't be
+        for(size_t offset = 0; offset < message_size;){
+            google::protobuf::io::CodedInputStream header(reinterpret_cast<const uint8_t*>(base_file->GetData() + offset)
+                                                        , static_cast<int>(std::min<size_t>(message_size - offset, 16)));
+            const uint32_t tag = header.ReadTag();
+            uint32_t field_size = 0;
+            if((tag & 7) != lengthDelimitedWireType || !header.ReadVarint32(&field_size)){
+                throw std::runtime_error("Can't parse the base");
+            }
+
+            offset += header.CurrentPosition();
+            if(field_size > message_size - offset){
+                throw std::runtime_error("Can't parse the base");
+            }
+            const char* field_data = base_file->GetData() + offset;
+            offset += field_size;
+
+            switch(tag >> 3){
+                case TC_PROTO::BusManager::kTransportCatalogueFieldNumber:
+                    MergeBusManagerField(proto_catalogue, field_data, field_size);
+                    break;
+                case TC_PROTO::BusManager::kRenderSettingsFieldNumber:
+                    MergeBusManagerField(proto_render_settings, field_data, field_size);
+                    break;
+                case TC_PROTO::BusManager::kTransportRouterFieldNumber: {
+                    auto& chunk = *google::protobuf::Arena::CreateMessage<TC_PROTO::TransportRouter>(&chunk_arena);
+                    MergeBusManagerField(chunk, field_data, field_size);
+                    AddRouterChunk(proto_router, chunk);
+                    chunk_arena.Reset();
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        // the matrix isn't read here, its pages are loaded on the first routes from each source
+        graph::RoutesMatrix routes_section;
+        if(trailer){
+            const auto* cells = reinterpret_cast<const graph::RoutesMatrix::Cell*>(base_file->GetData() + trailer->section_offset);
+            routes_section = graph::RoutesMatrix(trailer->vertex_count, cells, base_file);
+        }
+
+        ProtoToTransportCatalogue(catalogue, proto_catalogue);
+        ProtoToRenderSettings(render_settings, proto_render_settings);
+        ProtoToTransportRouter(transport_router, proto_router, routes_section);
+    }
+
+    void WriteFlatBase(const TransportCatalogue& catalogue, const map_settings_t& render_settings, const TransportRouter& transport_router, std::ostream& out_stream){
+        using namespace detail;
+
+        FlatBase::Writer writer(out_stream);
+        FlatNames names;
+
+        std::vector<FlatBase::Stop> stops;
+        stops.reserve(catalogue.GetStops().size());
+        for(const auto& stop : catalogue.GetStops()){
+            stops.push_back({stop.getCoordinates().lat, stop.getCoordinates().lng, names.Add(stop.GetName())});
+        }
+        writer.WriteSection(FlatBase::Section::STOPS, stops);
+
+        std::vector<FlatBase::Bus> buses;
+        std::vector<uint32_t> bus_stops;
+        buses.reserve(catalogue.GetBuses().size());
+        for(const auto& bus : catalogue.GetBuses()){
+            buses.push_back({names.Add(bus.GetName())
+                            , static_cast<uint32_t>(bus_stops.size())
+                            , static_cast<uint32_t>(bus.GetStops().size())
+                            , bus.IsCircular()
+                            , 0});
+            for(const Stop* stop : bus.GetStops()){
+                bus_stops.push_back(stop->GetIndex());
+            }
+        }
+        writer.WriteSection(FlatBase::Section::BUSES, buses);
+        writer.WriteSection(FlatBase::Section::BUS_STOPS, bus_stops);
+
+        // what FlatCatalogue answers from without loading the base
+        auto name_index = [](const auto& items){
+            std::vector<uint32_t> index(items.size());
+            std::iota(index.begin(), index.end(), 0);
+            std::stable_sort(index.begin(), index.end(), [&items](uint32_t lhs, uint32_t rhs){
+                return items[lhs].GetName() < items[rhs].GetName();
+            });
+            return index;
+        };
+        writer.WriteSection(FlatBase::Section::STOP_NAME_INDEX, name_index(catalogue.GetStops()));
+        writer.WriteSection(FlatBase::Section::BUS_NAME_INDEX, name_index(catalogue.GetBuses()));
+
+        std::vector<FlatBase::BusStats> bus_stats;
+        bus_stats.reserve(catalogue.GetBuses().size());
+        for(const auto& bus : catalogue.GetBuses()){
+            bus_stats.push_back({static_cast<uint32_t>(bus.GetStopsCount())
+                                , static_cast<uint32_t>(bus.GetStopsCountUnique())
+                                , bus.GetLengthTraveled()
+                                , 0
+                                , bus.GetLengthDirect()
+                                , bus.GetCurvature()});
+        }
+        writer.WriteSection(FlatBase::Section::BUS_STATS, bus_stats);
+
+        std::vector<FlatBase::Range> stop_bus_ranges;
+        std::vector<uint32_t> stop_buses;
+        stop_bus_ranges.reserve(catalogue.GetStops().size());
+        for(const auto& stop : catalogue.GetStops()){
+            stop_bus_ranges.push_back({static_cast<uint32_t>(stop_buses.size()), static_cast<uint32_t>(stop.GetBuses().size())});
+            for(const auto bus_name : stop.GetBuses()){
+                stop_buses.push_back(catalogue.GetBus(bus_name)->GetIndex());
+            }
+        }
+        writer.WriteSection(FlatBase::Section::STOP_BUS_RANGES, stop_bus_ranges);
+        writer.WriteSection(FlatBase::Section::STOP_BUSES, stop_buses);
+
+        std::vector<FlatBase::Distance> distances;
+        distances.reserve(catalogue.GetStopsDistances().size());
+        for(const auto& [stops, distance] : catalogue.GetStopsDistances()){
+            distances.push_back({static_cast<uint32_t>(stops.first->GetIndex()), static_cast<uint32_t>(stops.second->GetIndex()), distance});
+        }
+        writer.WriteSection(FlatBase::Section::DISTANCES, distances);
+
+        FlatBase::RenderSettings flat_render_settings{};
+        flat_render_settings.width = render_settings.width;
+        flat_render_settings.height = render_settings.height;
+        flat_render_settings.padding = render_settings.padding;
+        flat_render_settings.line_width = render_settings.line_width;
+        flat_render_settings.stop_radius = render_settings.stop_radius;
+        flat_render_settings.bus_label_offset_x = render_settings.bus_label_offset.x;
+        flat_render_settings.bus_label_offset_y = render_settings.bus_label_offset.y;
+        flat_render_settings.stop_label_offset_x = render_settings.stop_label_offset.x;
+        flat_render_settings.stop_label_offset_y = render_settings.stop_label_offset.y;
+        flat_render_settings.underlayer_width = render_settings.underlayer_width;
+        flat_render_settings.bus_label_font_size = render_settings.bus_label_font_size;
+        flat_render_settings.stop_label_font_size = render_settings.stop_label_font_size;
+        flat_render_settings.underlayer_color = ColorToFlat(render_settings.underlayer_color, names);
+        writer.WriteSection(FlatBase::Section::RENDER_SETTINGS, &flat_render_settings, 1);
+
+        std::vector<FlatBase::Color> palette;
+        palette.reserve(render_settings.color_palette.size());
+        for(const auto& color : render_settings.color_palette){
+            palette.push_back(ColorToFlat(color, names));
+        }
+        writer.WriteSection(FlatBase::Section::COLOR_PALETTE, palette);
+
+        const auto& graph = transport_router.GetGraph();
+        const auto& settings = transport_router.GetSettings();
+
+        const FlatBase::RoutingSettings routing_settings{static_cast<uint32_t>(settings.bus_velocity_kmh)
+                                                        , static_cast<uint32_t>(settings.bus_wait_time_min)
+                                                        , static_cast<uint32_t>(settings.router_type)
+                                                        , static_cast<uint32_t>(settings.graph_model)
+                                                        , graph.GetVertexCount()};
+        writer.WriteSection(FlatBase::Section::ROUTING_SETTINGS, &routing_settings, 1);
+
+        std::vector<FlatBase::Edge> edges;
+        edges.reserve(graph.GetEdgeCount());
+        for(const auto& edge : graph.GetEdges()){
+            edges.push_back({static_cast<uint32_t>(edge.from), static_cast<uint32_t>(edge.to), edge.weight});
+        }
+        writer.WriteSection(FlatBase::Section::EDGES, edges);
+
+        std::vector<FlatBase::EdgeInfo> edge_infos;
+        edge_infos.reserve(transport_router.GetEdgeInfos().size());
+        for(const auto& edge_info : transport_router.GetEdgeInfos()){
+            edge_infos.push_back({static_cast<uint32_t>(edge_info.type)
+                                , static_cast<uint32_t>(edge_info.bus_id)
+                                , static_cast<uint32_t>(edge_info.from)
+                                , static_cast<uint32_t>(edge_info.to)
+                                , static_cast<uint32_t>(edge_info.distance_m)
+                                , static_cast<uint32_t>(edge_info.span_count)});
+        }
+        writer.WriteSection(FlatBase::Section::EDGE_INFOS, edge_infos);
+
+        if(const auto* ch_router = dynamic_cast<const graph::ContractionHierarchy<TransportRouter::Weight>*>(&transport_router.GetRouter())){
+            const std::vector<uint32_t> ranks(ch_router->GetRanks().begin(), ch_router->GetRanks().end());
+            writer.WriteSection(FlatBase::Section::CH_RANKS, ranks);
+
+            std::vector<FlatBase::Shortcut> shortcuts;
+            shortcuts.reserve(ch_router->GetShortcuts().size());
+            for(const auto& shortcut : ch_router->GetShortcuts()){
+                shortcuts.push_back({static_cast<uint32_t>(shortcut.from)
+                                    , static_cast<uint32_t>(shortcut.to)
+                                    , shortcut.weight
+                                    , static_cast<uint32_t>(shortcut.first_edge)
+                                    , static_cast<uint32_t>(shortcut.second_edge)});
+            }
+            writer.WriteSection(FlatBase::Section::CH_SHORTCUTS, shortcuts);
+        }
+
+        if(const auto* all_pairs_router = dynamic_cast<const graph::Router<TransportRouter::Weight>*>(&transport_router.GetRouter())){
+            const auto& matrix = all_pairs_router->GetRoutesInternalData();
+            writer.WriteSection(FlatBase::Section::ROUTES_MATRIX, matrix.GetCells(), graph::RoutesMatrix::GetCellCount(matrix.GetVertexCount()));
+        }
+
+        writer.WriteSection(FlatBase::Section::NAMES, names.GetChars());
+
+        writer.Finish();
+    }
+
+    void ReadFlatRenderSettings(map_settings_t& render_settings, const FlatBase::Reader& reader){
+        using namespace detail;
+
+        const auto& flat_render_settings = reader.GetRecord<FlatBase::RenderSettings>(FlatBase::Section::RENDER_SETTINGS);
+        render_settings.width = flat_render_settings.width;
+        render_settings.height = flat_render_settings.height;
+        render_settings.padding = flat_render_settings.padding;
+        render_settings.line_width = flat_render_settings.line_width;
+        render_settings.stop_radius = flat_render_settings.stop_radius;
+        render_settings.bus_label_font_size = flat_render_settings.bus_label_font_size;
+        render_settings.bus_label_offset = {flat_render_settings.bus_label_offset_x, flat_render_settings.bus_label_offset_y};
+        render_settings.stop_label_font_size = flat_render_settings.stop_label_font_size;
+        render_settings.stop_label_offset = {flat_render_settings.stop_label_offset_x, flat_render_settings.stop_label_offset_y};
+        render_settings.underlayer_color = FlatToColor(flat_render_settings.underlayer_color, reader);
+        render_settings.underlayer_width = flat_render_settings.underlayer_width;
+
+        render_settings.color_palette.clear();
+        for(const auto& color : reader.GetSection<FlatBase::Color>(FlatBase::Section::COLOR_PALETTE)){
+            render_settings.color_palette.push_back(FlatToColor(color, reader));
+        }
+    }
+
+    void ReadFlatBase(TransportCatalogue& catalogue, map_settings_t& render_settings, TransportRouter& transport_router, std::shared_ptr<const io::MappedFile> base_file){
+        using namespace detail;
+
+        const FlatBase::Reader reader(std::move(base_file));
+
+        const auto stops = reader.GetSection<FlatBase::Stop>(FlatBase::Section::STOPS);
+        for(const auto& stop : stops){
+            catalogue.AddStop(reader.GetName(stop.name), {stop.latitude, stop.longitude});
+        }
+        const size_t stop_count = catalogue.GetStops().size();
+
+        for(const auto& distance : reader.GetSection<FlatBase::Distance>(FlatBase::Section::DISTANCES)){
+            if(distance.from >= stop_count || distance.to >= stop_count){
+                ThrowCorruptedBase();
+            }
+            catalogue.AddDistance(distance.from, distance.to, distance.distance);
+        }
+
+        const auto bus_stops = reader.GetSection<uint32_t>(FlatBase::Section::BUS_STOPS);
+        const size_t bus_stops_count = bus_stops.end() - bus_stops.begin();
+
+        const auto buses = reader.GetSection<FlatBase::Bus>(FlatBase::Section::BUSES);
+        const auto bus_stats = reader.GetSection<FlatBase::BusStats>(FlatBase::Section::BUS_STATS);
+        // written before stats were stored otherwise
+        const bool has_bus_stats = bus_stats.end() - bus_stats.begin() == buses.end() - buses.begin();
+
+        std::vector<size_t> indexed_stops;
+        for(const auto& bus : buses){
+            if(bus.stops_count == 0 || bus.stops_begin > bus_stops_count || bus.stops_count > bus_stops_count - bus.stops_begin){
+                ThrowCorruptedBase();
+            }
+
+            indexed_stops.assign(bus_stops.begin() + bus.stops_begin, bus_stops.begin() + bus.stops_begin + bus.stops_count);
+            if(std::any_of(indexed_stops.begin(), indexed_stops.end(), [stop_count](size_t index){ return index >= stop_count; })){
+                ThrowCorruptedBase();
+            }
+
+            if(!has_bus_stats){
+                catalogue.AddRoute(reader.GetName(bus.name), indexed_stops, bus.is_roundtrip);
+                continue;
+            }
+
+            const auto& flat_stats = bus_stats.begin()[&bus - buses.begin()];
+            route_stats_t stats;
+            stats.stops_count = flat_stats.stop_count;
+            stats.stops_unique_count = flat_stats.unique_stop_count;
+            stats.length_direct = flat_stats.direct_length;
+            stats.length_traveled = flat_stats.route_length;
+            stats.curvature = flat_stats.curvature;
+
+            catalogue.AddRoute(reader.GetName(bus.name), indexed_stops, bus.is_roundtrip, stats);
+        }
+
+        ReadFlatRenderSettings(render_settings, reader);
+
+        const auto& flat_routing_settings = reader.GetRecord<FlatBase::RoutingSettings>(FlatBase::Section::ROUTING_SETTINGS);
+        if(flat_routing_settings.router_type > static_cast<uint32_t>(router_type_t::ASTAR)
+            || flat_routing_settings.graph_model > static_cast<uint32_t>(graph_model_t::COMPACT)){
+            ThrowCorruptedBase();
+        }
+
+        routing_settings_t settings;
+        settings.bus_velocity_kmh = flat_routing_settings.bus_velocity_kmh;
+        settings.bus_wait_time_min = flat_routing_settings.bus_wait_time_min;
+        settings.router_type = static_cast<router_type_t>(flat_routing_settings.router_type);
+        settings.graph_model = static_cast<graph_model_t>(flat_routing_settings.graph_model);
         transport_router.SetSettings(settings);
 
-        std::vector<TransportRouter::EdgeInfo> edge_infos;
-        edge_infos.reserve(proto_router.edge_infos_size());
+        const size_t vertex_count = GetGraphVertexCount(transport_router, flat_routing_settings.vertex_count);
 
-        for(const auto& proto_edge_info : proto_router.edge_infos()){
-            TransportRouter::EdgeInfo edge_info;
-            edge_info.bus_id = proto_edge_info.bus_id();
-            edge_info.distance_m = proto_edge_info.distance_m();
-            edge_info.from = proto_edge_info.from();
-            edge_info.to = proto_edge_info.to();
-            edge_info.span_count = proto_edge_info.span_count();
-            edge_infos.push_back(std::move(edge_info));
+        const auto flat_edges = reader.GetSection<FlatBase::Edge>(FlatBase::Section::EDGES);
+
+        std::vector<graph::Edge<TransportRouter::Weight>> edges;
+        edges.reserve(flat_edges.end() - flat_edges.begin());
+        for(const auto& edge : flat_edges){
+            if(edge.from >= vertex_count || edge.to >= vertex_count){
+                ThrowCorruptedBase();
+            }
+            edges.push_back({edge.from, edge.to, edge.weight});
         }
+        transport_router.SetGraph(std::make_unique<graph::DirectedWeightedGraph<TransportRouter::Weight>>(vertex_count, std::move(edges)));
 
+        const auto flat_edge_infos = reader.GetSection<FlatBase::EdgeInfo>(FlatBase::Section::EDGE_INFOS);
+
+        std::vector<TransportRouter::EdgeInfo> edge_infos;
+        edge_infos.reserve(flat_edge_infos.end() - flat_edge_infos.begin());
+        for(const auto& flat_edge_info : flat_edge_infos){
+            TransportRouter::EdgeInfo edge_info;
+            edge_info.type = static_cast<TransportRouter::EdgeType>(flat_edge_info.type);
+            edge_info.bus_id = flat_edge_info.bus_id;
+            edge_info.from = flat_edge_info.from;
+            edge_info.to = flat_edge_info.to;
+            edge_info.distance_m = flat_edge_info.distance_m;
+            edge_info.span_count = flat_edge_info.span_count;
+            edge_infos.push_back(edge_info);
+        }
+        CheckEdgeInfos(transport_router, edge_infos);
         transport_router.SetEdgeInfos(edge_infos);
-    }
 
-    void DeseriallizeBusManager(TransportCatalogue& catalogue, map_settings_t& render_settings, TransportRouter& transport_router, std::istream& in_stream){
-        
-        TC_PROTO::BusManager bus_manager;
+        const auto cells = reader.GetSection<graph::RoutesMatrix::Cell>(FlatBase::Section::ROUTES_MATRIX);
+        const auto ranks = reader.GetSection<uint32_t>(FlatBase::Section::CH_RANKS);
 
-        bus_manager.ParseFromIstream(&in_stream);
+        if(settings.router_type == router_type_t::ALL_PAIRS && cells.begin() != cells.end()){
+            if(static_cast<size_t>(cells.end() - cells.begin()) != graph::RoutesMatrix::GetCellCount(vertex_count)){
+                ThrowCorruptedBase();
+            }
+
+            // the matrix isn't read here, its pages are loaded on the first routes from each source
+            graph::RoutesMatrix router_data(vertex_count, cells.begin(), reader.GetFile());
+            transport_router.SetRouter(std::make_unique<graph::Router<TransportRouter::Weight>>(transport_router.GetGraph(), router_data));
+        } else
+        if(settings.router_type == router_type_t::CONTRACTION_HIERARCHY && ranks.begin() != ranks.end()){
+            using ContractionHierarchy = graph::ContractionHierarchy<TransportRouter::Weight>;
+
+            std::vector<size_t> ch_ranks(ranks.begin(), ranks.end());
 
-        ProtoToTransportCatalogue(catalogue,  bus_manager.transport_catalogue());
-        ProtoToRenderSettings(render_settings, bus_manager.render_settings());
-        ProtoToTransportRouter(transport_router, bus_manager.transport_router());
+            std::vector<ContractionHierarchy::Shortcut> shortcuts;
+            for(const auto& shortcut : reader.GetSection<FlatBase::Shortcut>(FlatBase::Section::CH_SHORTCUTS)){
+                shortcuts.push_back({shortcut.from, shortcut.to, shortcut.weight, shortcut.first_edge, shortcut.second_edge});
+            }
+
+            transport_router.SetRouter(MakeStoredHierarchy(transport_router, ch_ranks, shortcuts));
+        } else {
+            transport_router.BuildRouter();
+        }
     }
 
-}
\ No newline at end of file
+}
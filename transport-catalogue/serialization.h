@@ -2,17 +2,37 @@
 
 #include <transport_catalogue.pb.h>
 #include <fstream>
+#include <memory>
 
 #include "domain.h"
+#include "flat_base.h"
+#include "mapped_file.h"
 #include "transport_router.h"
 
 namespace TC{
 
-    TC_PROTO::RenderSettings* RenderSettingsToProto(const map_settings_t& settings);
+    /* fill messages in place, so they can be created on an arena */
+    void RenderSettingsToProto(const map_settings_t& settings, TC_PROTO::RenderSettings& settings_proto);
 
-    TC_PROTO::TransportCatalogue* TransportCatalogueToProto(const TransportCatalogue& catalogue);
+    void TransportCatalogueToProto(const TransportCatalogue& catalogue, TC_PROTO::TransportCatalogue& proto_catalogue);
 
-    TC_PROTO::TransportRouter* TransportRouterToProto(const TransportRouter& transport_router);
+    /* protobuf base: the BusManager message written field by field, the router's graph and
+       the rest of its arrays in bounded chunks, then the routes section */
+    void WriteBusManager(const TransportCatalogue& catalogue, const map_settings_t& render_settings, const TransportRouter& transport_router, std::ostream& out_stream);
 
-    void DeseriallizeBusManager(TransportCatalogue& catalogue, map_settings_t& render_settings, TransportRouter& router, std::istream& in_stream);
+    /* appends the all-pairs routes matrix as a raw section after the BusManager message,
+       does nothing for other routers */
+    void WriteRoutesSection(const TransportRouter& transport_router, std::ostream& out_stream);
+
+    /* the whole base as FlatBase sections, the routes matrix is written from the router's memory */
+    void WriteFlatBase(const TransportCatalogue& catalogue, const map_settings_t& render_settings, const TransportRouter& transport_router, std::ostream& out_stream);
+
+    /* base_file has to be a FlatBase, records are read in place and the routes matrix is used as is */
+    void ReadFlatBase(TransportCatalogue& catalogue, map_settings_t& render_settings, TransportRouter& transport_router, std::shared_ptr<const io::MappedFile> base_file);
+
+    /* render settings alone, they don't need the rest of the base */
+    void ReadFlatRenderSettings(map_settings_t& render_settings, const FlatBase::Reader& reader);
+
+    /* protobuf base, the routes section is used in place, so the router keeps base_file mapped */
+    void DeseriallizeBusManager(TransportCatalogue& catalogue, map_settings_t& render_settings, TransportRouter& router, std::shared_ptr<const io::MappedFile> base_file);
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "thread_pool.h"
+
+namespace parallel {
+
+    ThreadPool::ThreadPool(size_t thread_count){
+
+        if(thread_count == 0){
+            const size_t hardware_threads = std::thread::hardware_concurrency();
+            thread_count = hardware_threads > 1 ? hardware_threads - 1 : 0;
+        }
+
+        workers_.reserve(thread_count);
+        for(size_t i = 0; i < thread_count; ++i){
+            workers_.emplace_back([this]{ WorkerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool(){
+        {
+            std::lock_guard guard(mutex_);
+            stopping_ = true;
+        }
+        has_tasks_.notify_all();
+
+        for(auto& worker : workers_){
+            worker.join();
+        }
+    }
+
+    void ThreadPool::Enqueue(std::function<void()> task){
+        {
+            std::lock_guard guard(mutex_);
+            tasks_.push(std::move(task));
+        }
+        has_tasks_.notify_one();
+    }
+
+    void ThreadPool::WorkerLoop(){
+        while(true){
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex_);
+                has_tasks_.wait(lock, [this]{ return stopping_ || !tasks_.empty(); });
+
+                if(tasks_.empty())
+                    return;
+
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+} // namespace parallel
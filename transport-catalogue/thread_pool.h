@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+// fixed set of worker threads fed from one task queue
+class ThreadPool {
+
+public:
+    /* thread_count - workers besides the calling thread, 0 means hardware concurrency - 1 */
+    explicit ThreadPool(size_t thread_count = 0);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+    /* workers plus the calling thread */
+    size_t GetConcurrency() const{
+        return workers_.size() + 1;
+    }
+
+    /* runs func(i) for every i in [0, count) on the workers and the calling thread,
+       returns when all calls are done, rethrows the first exception thrown by func */
+    template <typename Func>
+    void ParallelFor(size_t count, Func func);
+
+private:
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    bool stopping_ = false;
+};
+
+template <typename Func>
+void ThreadPool::ParallelFor(size_t count, Func func) {
+
+    if (count == 0) {
+        return;
+    }
+
+    // helpers may start after all work is taken (e.g. when called from a busy worker),
+    // such late ones only touch this shared state and never call func
+    struct State {
+        std::atomic<size_t> next_index{0};
+        size_t done = 0;
+        size_t active = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    auto state = std::make_shared<State>();
+
+    auto run = [state, count, &func] {
+        {
+            std::lock_guard guard(state->mutex);
+            ++state->active;
+        }
+        size_t done = 0;
+        std::exception_ptr error;
+        for (size_t i = state->next_index++; i < count; i = state->next_index++) {
+            try {
+                func(i);
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            ++done;
+        }
+        std::lock_guard guard(state->mutex);
+        state->done += done;
+        if (error && !state->error) {
+            state->error = error;
+        }
+        if (--state->active == 0) {
+            state->finished.notify_all();
+        }
+    };
+
+    const size_t helpers = std::min(workers_.size(), count - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        Enqueue(run);
+    }
+
+    run();
+
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == count && state->active == 0; });
+
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+}  // namespace parallel
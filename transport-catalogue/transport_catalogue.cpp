@@ -1,4 +1,5 @@
 #include "transport_catalogue.h"
+#include <cmath>
 #include <unordered_set>
 
 namespace TC {
@@ -39,54 +40,86 @@ namespace TC {
         
     }
 
-    void TransportCatalogue::AddRoute(std::string_view name, const std::vector<size_t>& stops, bool is_circular){
+    bool operator==(const route_stats_t& lhs, const route_stats_t& rhs){
+        const bool same_curvature = lhs.curvature == rhs.curvature
+                                    || (std::isnan(lhs.curvature) && std::isnan(rhs.curvature));
+        return lhs.stops_count == rhs.stops_count
+            && lhs.stops_unique_count == rhs.stops_unique_count
+            && lhs.length_direct == rhs.length_direct
+            && lhs.length_traveled == rhs.length_traveled
+            && same_curvature;
+    }
+
+    bool operator!=(const route_stats_t& lhs, const route_stats_t& rhs){
+        return !(lhs == rhs);
+    }
+
+    Bus* TransportCatalogue::AddBus(std::string_view name, const std::vector<size_t>& stops, bool is_circular){
 
         buses_.push_back(Bus((std::string(name))));
         Bus* bus = &buses_.back();
 
         bus->index = buses_.size() - 1;
-
-        std::unordered_set<std::string_view> unique_stops;
-        Stop * prev_stop = GetStopByIndex(stops[0]);
-        Coordinates prev_coordinate = prev_stop->coordinates;
+        bus->isCircle = is_circular;
 
         for (size_t stop_index : stops){
             Stop * stored_stop = GetStopByIndex(stop_index);
 
             bus->stops.push_back(stored_stop);
-            unique_stops.insert(stored_stop->GetName());
-
             stored_stop->buses.insert(bus->name);
+        }
 
-            bus->length_direct += ComputeDistance(stored_stop->coordinates, prev_coordinate);
-            prev_coordinate = stored_stop->coordinates;
+        busname_to_bus_.insert({bus->name, bus});
 
-            bus->length_traveled += GetDistance(prev_stop, stored_stop);
-            prev_stop = stored_stop;
-        }
+        return bus;
+    }
 
-        if(is_circular){
-            bus->isCircle = true;
+    void TransportCatalogue::AddRoute(std::string_view name, const std::vector<size_t>& stops, bool is_circular){
+        Bus* bus = AddBus(name, stops, is_circular);
+        bus->stats = ComputeRouteStats(*bus);
+    }
 
-            bus->stops_count = bus->stops.size();
+    void TransportCatalogue::AddRoute(std::string_view name, const std::vector<size_t>& stops, bool is_circular, const route_stats_t& stats){
+        AddBus(name, stops, is_circular)->stats = stats;
+    }
+
+    route_stats_t TransportCatalogue::ComputeRouteStats(const Bus& bus) const{
+
+        route_stats_t stats;
+
+        std::unordered_set<std::string_view> unique_stops;
+        Stop * prev_stop = bus.stops.front();
+        Coordinates prev_coordinate = prev_stop->coordinates;
+
+        for (Stop * stop : bus.stops){
+            unique_stops.insert(stop->GetName());
+
+            stats.length_direct += ComputeDistance(stop->coordinates, prev_coordinate);
+            prev_coordinate = stop->coordinates;
+
+            stats.length_traveled += GetDistance(prev_stop, stop);
+            prev_stop = stop;
+        }
+
+        if(bus.isCircle){
+            stats.stops_count = bus.stops.size();
         } else {
-            bus->stops_count = bus->stops.size() * 2 - 1;
-            bus->length_direct *= 2;
+            stats.stops_count = bus.stops.size() * 2 - 1;
+            stats.length_direct *= 2;
 
-            prev_stop = bus->stops.back();
-            
-            for(auto begin = bus->stops.rbegin(); begin != bus->stops.rend(); ++begin){
-                bus->length_traveled += GetDistance(prev_stop, *begin);
+            prev_stop = bus.stops.back();
+
+            for(auto begin = bus.stops.rbegin(); begin != bus.stops.rend(); ++begin){
+                stats.length_traveled += GetDistance(prev_stop, *begin);
                 prev_stop = *begin;
             }
         }
 
-        bus->curvature = bus->length_traveled / bus->length_direct;
-
-        bus->stops_unique_count = unique_stops.size();
+        stats.curvature = stats.length_traveled / stats.length_direct;
 
-        busname_to_bus_.insert({bus->name, bus});
+        stats.stops_unique_count = unique_stops.size();
 
+        return stats;
     }
 
     bool TransportCatalogue::ContainsBus(std::string_view name) const{
@@ -121,15 +154,15 @@ namespace TC {
     }
 
     double TransportCatalogue::GetRouteLengthDirect(std::string_view name) const{
-        return busname_to_bus_.at(name)->length_direct;
+        return busname_to_bus_.at(name)->GetLengthDirect();
     }
 
     int TransportCatalogue::GetRouteStopsCount(std::string_view name) const{
-        return busname_to_bus_.at(name)->stops_count;
+        return busname_to_bus_.at(name)->GetStopsCount();
     }
 
     int TransportCatalogue::GetRouteStopsUniqueCount(std::string_view name) const{
-        return busname_to_bus_.at(name)->stops_unique_count;
+        return busname_to_bus_.at(name)->GetStopsCountUnique();
     }
 
 } // namespace TC
\ No newline at end of file
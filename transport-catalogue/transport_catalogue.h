@@ -33,17 +33,26 @@ namespace TC {
         size_t GetIndex() const {return index;}
     };
 
+    /* what is derived from the stops of a route and distances between them */
+    struct route_stats_t {
+        uint32_t stops_count = 0;
+        uint32_t stops_unique_count = 0;
+        double length_direct = 0;
+        uint32_t length_traveled = 0;
+        double curvature = 0;   // NaN for a route that doesn't go anywhere
+    };
+
+    /* NaN curvatures are equal here, stats of the same route compare equal */
+    bool operator==(const route_stats_t& lhs, const route_stats_t& rhs);
+    bool operator!=(const route_stats_t& lhs, const route_stats_t& rhs);
+
     class Bus {
         std::string name;
         std::deque<Stop*> stops;
 
         friend TransportCatalogue;
 
-        uint32_t stops_count = 0;
-        uint32_t stops_unique_count = 0;
-        double length_direct = 0;
-        uint32_t length_traveled = 0;
-        double curvature = 0;
+        route_stats_t stats;
 
         bool isCircle = false;
 
@@ -54,11 +63,12 @@ namespace TC {
 
         std::string_view GetName() const { return name;}
         const std::string& GetNameStr() const {return name;}
-        double GetLengthDirect() const {return length_direct;}
-        uint32_t GetLengthTraveled() const {return length_traveled;}
-        double GetCurvature() const {return curvature;}
-        int GetStopsCount() const {return stops_count;}
-        int GetStopsCountUnique() const {return stops_unique_count;}
+        double GetLengthDirect() const {return stats.length_direct;}
+        uint32_t GetLengthTraveled() const {return stats.length_traveled;}
+        double GetCurvature() const {return stats.curvature;}
+        int GetStopsCount() const {return stats.stops_count;}
+        int GetStopsCountUnique() const {return stats.stops_unique_count;}
+        const route_stats_t& GetStats() const {return stats;}
         bool IsCircular() const {return isCircle;}
         const std::deque<Stop*>& GetStops() const {return stops;}
         uint32_t GetIndex() const {return index;}
@@ -68,6 +78,9 @@ namespace TC {
 
     private:
 
+        /* adds the bus without stats, links its stops to it */
+        Bus* AddBus(std::string_view name, const std::vector<size_t>& stops, bool is_circular);
+
         std::deque<Stop> stops_;
         std::unordered_map<std::string_view, Stop*> stopname_to_stops_;
 
@@ -94,6 +107,12 @@ namespace TC {
         /* stops - list of stops(their index) */
         void AddRoute(std::string_view name, const std::vector<size_t>& stops, bool is_circular);
 
+        /* same with stats computed before, e.g. stored in a base. They are trusted as they are */
+        void AddRoute(std::string_view name, const std::vector<size_t>& stops, bool is_circular, const route_stats_t& stats);
+
+        /* stats of the bus as AddRoute computes them from its stops and current distances */
+        route_stats_t ComputeRouteStats(const Bus& bus) const;
+
         bool ContainsBus(std::string_view name) const;
         Bus* GetBus(std::string_view name) const;
 
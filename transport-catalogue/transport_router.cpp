@@ -6,25 +6,186 @@ namespace TC {
 
         SetSettings(settings);
 
-        graph_ = std::make_unique<graph::DirectedWeightedGraph<Weight>>();
+        next_vertex_ = catalogue_.GetStops().size();
 
-        for(const auto& bus : catalogue_.GetBuses()){
+        if(settings_.graph_model == graph_model_t::COMPACT){
 
-            const auto& stops = bus.GetStops();
+            graph_ = std::make_unique<graph::DirectedWeightedGraph<Weight>>(GetModelVertexCount());
 
-            AddStopsToGraph(stops.begin(), stops.end(), bus.GetName());
+            for(const auto& bus : catalogue_.GetBuses()){
 
-            if(!bus.IsCircular()) {
+                const auto& stops = bus.GetStops();
 
-                AddStopsToGraph(stops.rbegin(), stops.rend(), bus.GetName());
+                AddRideToGraph(stops.begin(), stops.end(), bus);
 
+                if(!bus.IsCircular()) {
+
+                    AddRideToGraph(stops.rbegin(), stops.rend(), bus);
+
+                }
+            }
+
+        } else {
+
+            graph_ = std::make_unique<graph::DirectedWeightedGraph<Weight>>(next_vertex_);
+
+            for(const auto& bus : catalogue_.GetBuses()){
+
+                const auto& stops = bus.GetStops();
+
+                AddStopsToGraph(stops.begin(), stops.end(), bus.GetName());
+
+                if(!bus.IsCircular()) {
+
+                    AddStopsToGraph(stops.rbegin(), stops.rend(), bus.GetName());
+
+                }
             }
         }
         
-        router_ = std::make_unique<graph::Router<Weight>>(*graph_);
+        // the matrix grows with the square of the graph, and the compact model has more vertices than stops
+        if(settings_.router_type == router_type_t::AUTO){
+            settings_.router_type = graph_->GetVertexCount() > allPairsVertexLimit
+                                        ? router_type_t::ASTAR
+                                        : router_type_t::ALL_PAIRS;
+        }
+
+        BuildRouter();
+    }
+
+    size_t TransportRouter::GetModelVertexCount() const{
+
+        size_t vertex_count = catalogue_.GetStops().size();
+
+        if(settings_.graph_model == graph_model_t::COMPACT){
+            for(const auto& bus : catalogue_.GetBuses()){
+                vertex_count += bus.GetStops().size() * (bus.IsCircular() ? 1 : 2);
+            }
+        }
+
+        return vertex_count;
     }
 
-    std::optional<TransportRouter::Travel> TransportRouter::Route(std::string_view from, std::string_view to){
+    void TransportRouter::BuildRouter(){
+
+        switch(settings_.router_type){
+            case router_type_t::DIJKSTRA:
+                router_ = std::make_unique<graph::DijkstraRouter<Weight>>(*graph_, dijkstraCacheCapacity);
+                break;
+            case router_type_t::CONTRACTION_HIERARCHY:
+                router_ = std::make_unique<graph::ContractionHierarchy<Weight>>(*graph_);
+                break;
+            case router_type_t::ASTAR:
+                router_ = std::make_unique<graph::AStarRouter<Weight>>(*graph_, MakeGeoLowerBound());
+                break;
+            default: {
+                parallel::ThreadPool thread_pool;
+                router_ = std::make_unique<graph::Router<Weight>>(*graph_, thread_pool);
+            }
+        }
+    }
+
+    graph::AStarRouter<TransportRouter::Weight>::LowerBound TransportRouter::MakeGeoLowerBound() const{
+
+        // stop vertices come first, ride vertices of the compact model take the stop of their edges
+        std::vector<Geo::Coordinates> coordinates(graph_->GetVertexCount());
+
+        for(size_t vertex = 0; vertex < std::min(coordinates.size(), catalogue_.GetStops().size()); ++vertex){
+            coordinates[vertex] = catalogue_.GetStopByIndex(vertex)->getCoordinates();
+        }
+
+        for(graph::EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id){
+            const auto& edge = graph_->GetEdge(edge_id);
+            const auto& edge_info = edge_infos_[edge_id];
+            if(edge_info.type == EdgeType::BOARD || edge_info.type == EdgeType::RIDE){
+                coordinates[edge.to] = catalogue_.GetStopByIndex(edge_info.to)->getCoordinates();
+            } else
+            if(edge_info.type == EdgeType::ALIGHT){
+                coordinates[edge.from] = catalogue_.GetStopByIndex(edge_info.from)->getCoordinates();
+            }
+        }
+
+        // weights are road distances (plus wait time as distance) which may be shorter than
+        // the great-circle ones, the scale is the smallest weight to distance ratio over all edges
+        double scale = std::numeric_limits<double>::infinity();
+
+        for(const auto& edge : graph_->GetEdges()){
+            const double distance = Geo::ComputeDistance(coordinates[edge.from], coordinates[edge.to]);
+            if(distance > 0){
+                scale = std::min(scale, edge.weight / distance);
+            }
+        }
+
+        if(scale == std::numeric_limits<double>::infinity()){
+            scale = 0;
+        }
+        // margin for rounding, a slightly overestimated bound could lose the shortest route
+        scale *= 1 - 1e-9;
+
+        return [coordinates = std::move(coordinates), scale](graph::VertexId from, graph::VertexId to){
+            // acos of close points may give NaN
+            const double distance = Geo::ComputeDistance(coordinates[from], coordinates[to]);
+            return distance > 0 ? scale * distance : 0;
+        };
+    }
+
+    TransportRouter::TravelTimes TransportRouter::RouteMatrix(const std::vector<std::string_view>& from, const std::vector<std::string_view>& to) const{
+
+        // stops that can't be routed get a vertex out of the graph
+        auto to_vertices = [this](const std::vector<std::string_view>& names){
+            std::vector<graph::VertexId> vertices;
+            vertices.reserve(names.size());
+            for(const auto name : names){
+                const auto stop = catalogue_.GetStop(name);
+                vertices.push_back(stop && stop->GetBusCount() ? stop->GetIndex() : graph_->GetVertexCount());
+            }
+            return vertices;
+        };
+
+        const auto sources = to_vertices(from);
+        const auto targets = to_vertices(to);
+
+        std::vector<std::optional<Weight>> weights;
+
+        if(const auto* all_pairs_router = dynamic_cast<const graph::Router<Weight>*>(router_.get())){
+            const auto& matrix = all_pairs_router->GetRoutesInternalData();
+            weights.resize(sources.size() * targets.size());
+            for(size_t row = 0; row < sources.size(); ++row){
+                if(sources[row] >= matrix.GetVertexCount()){
+                    continue;
+                }
+                const auto* row_weights = matrix.GetWeights(sources[row]);
+                for(size_t column = 0; column < targets.size(); ++column){
+                    if(targets[column] < matrix.GetVertexCount() && row_weights[targets[column]] != graph::RoutesMatrix::UNREACHABLE){
+                        weights[row * targets.size() + column] = row_weights[targets[column]];
+                    }
+                }
+            }
+        } else {
+            std::call_once(many_to_many_router_flag_, [this]{
+                many_to_many_router_ = std::make_unique<graph::ManyToManyRouter<Weight>>(*graph_);
+            });
+            weights = many_to_many_router_->BuildMatrix(sources, targets);
+        }
+
+        TravelTimes result(from.size(), std::vector<std::optional<double>>(to.size()));
+
+        for(size_t row = 0; row < from.size(); ++row){
+            for(size_t column = 0; column < to.size(); ++column){
+                // same as Route, a stop is reachable from itself even without buses
+                if(from[row] == to[column]){
+                    result[row][column] = 0;
+                } else
+                if(const auto& weight = weights[row * to.size() + column]){
+                    result[row][column] = DistanceToTime(*weight);
+                }
+            }
+        }
+
+        return result;
+    }
+
+    std::optional<TransportRouter::Travel> TransportRouter::Route(std::string_view from, std::string_view to) const{
 
         if(from == to)
             return Travel{{}, 0};
@@ -49,13 +210,29 @@ namespace TC {
 
         travel.total_time_min = DistanceToTime(info->weight);
 
+        size_t ride_distance = 0;
+
         for(auto begin = (info->edges.begin()); begin < info->edges.end(); ++begin ){
             
             auto edgeID = *begin;
+            const auto& edge_info = edge_infos_[edgeID];
+
+            if(edge_info.type == EdgeType::RIDE){
+                ride_distance += edge_info.distance_m;
+                travel.lines.back().span_count += edge_info.span_count;
+                continue;
+            }
+
+            if(edge_info.type == EdgeType::ALIGHT){
+                travel.lines.back().time_min = DistanceToTime(ride_distance);
+                ride_distance = 0;
+                continue;
+            }
 
+            // SPAN and BOARD both start with waiting at the stop
             RouteLine line;
 
-            index_from = edge_infos_[edgeID].from;
+            index_from = edge_info.from;
 
             travel.lines.push_back({RouteLine_t::WAIT
                 ,catalogue_.GetStopByIndex(index_from)->GetName()
@@ -64,9 +241,9 @@ namespace TC {
                 });
 
             line.type = RouteLine_t::BUS;
-            line.time_min = DistanceToTime(edge_infos_[edgeID].distance_m);
-            line.name = (catalogue_.GetBuses()[edge_infos_[edgeID].bus_id]).GetName();
-            line.span_count = edge_infos_[edgeID].span_count;
+            line.time_min = DistanceToTime(edge_info.distance_m);
+            line.name = (catalogue_.GetBuses()[edge_info.bus_id]).GetName();
+            line.span_count = edge_info.span_count;
 
             travel.lines.push_back(std::move(line));
 
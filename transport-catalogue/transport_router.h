@@ -2,8 +2,13 @@
 
 #include "transport_catalogue.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "contraction_hierarchy.h"
+#include "astar_router.h"
+#include "many_to_many_router.h"
 #include "domain.h"
 #include <memory>
+#include <mutex>
 
 namespace TC {
 
@@ -13,6 +18,10 @@ public:
 
     using Weight = size_t;
 
+    // graphs with more vertices than this get a per-request A* engine instead of the all-pairs matrix
+    static constexpr size_t allPairsVertexLimit = 1000;
+    static constexpr size_t dijkstraCacheCapacity = 64;
+
     TransportRouter(const TransportCatalogue& catalogue, routing_settings_t settings);
 
     TransportRouter(const TransportCatalogue& catalogue) : catalogue_(catalogue){};
@@ -34,7 +43,15 @@ public:
         double total_time_min;
     };
 
+    enum class EdgeType{
+        SPAN,       // complete model: wait and ride over span_count stops
+        BOARD,      // compact model: wait at stop 'from'
+        RIDE,       // compact model: ride to the next stop
+        ALIGHT,     // compact model: leave bus at stop 'to'
+    };
+
     struct EdgeInfo{
+        EdgeType type = EdgeType::SPAN;
         size_t bus_id;
         size_t from;
         size_t to;
@@ -42,10 +59,17 @@ public:
         size_t span_count;
     };
 
-    std::optional<Travel> Route(std::string_view from, std::string_view to);
+    // total times in minutes, row per 'from' stop, nullopt where there is no route
+    using TravelTimes = std::vector<std::vector<std::optional<double>>>;
+
+    /* safe to call concurrently */
+    std::optional<Travel> Route(std::string_view from, std::string_view to) const;
+
+    /* times only, for many pairs at once */
+    TravelTimes RouteMatrix(const std::vector<std::string_view>& from, const std::vector<std::string_view>& to) const;
 
     // convert distance in meters to time traveled in minutes
-    inline double DistanceToTime(size_t distance_m){
+    inline double DistanceToTime(size_t distance_m) const{
         return 1.0 * distance_m  / settings_.bus_velocity_kmh / distanceTimeMulti;
     }
 
@@ -53,7 +77,7 @@ public:
         return *graph_;
     }
 
-    const graph::Router<Weight>& GetRouter() const{
+    const graph::RoutingEngine<Weight>& GetRouter() const{
         return *router_;
     }
 
@@ -61,14 +85,24 @@ public:
         return settings_;
     }
 
+    const TransportCatalogue& GetCatalogue() const{
+        return catalogue_;
+    }
+
     void SetGraph(std::unique_ptr<graph::DirectedWeightedGraph<Weight>>&& graph){
         graph_ = std::move(graph);
     }
 
-    void SetRouter(std::unique_ptr<graph::Router<Weight>>&& router){
+    void SetRouter(std::unique_ptr<graph::RoutingEngine<Weight>>&& router){
         router_ = std::move(router);
     }
 
+    /* builds engine of settings router type over the current graph */
+    void BuildRouter();
+
+    /* vertices the graph model of the settings needs for the catalogue */
+    size_t GetModelVertexCount() const;
+
     void SetSettings(routing_settings_t& settings){
         settings_ = std::move(settings);
         bus_wait_distance_ = 1.0 * settings_.bus_wait_time_min * settings_.bus_velocity_kmh * distanceTimeMulti;
@@ -84,12 +118,59 @@ public:
 
 private:
 
+    /* great-circle distance between vertex stops scaled down to never exceed the graph weights,
+       so it is a consistent lower bound for A* */
+    graph::AStarRouter<Weight>::LowerBound MakeGeoLowerBound() const;
+
     inline void StoreEdgeInfo(graph::EdgeId id, const EdgeInfo& info){
         if(id >= edge_infos_.size())
             edge_infos_.resize(id * 1.5 + 2);
         edge_infos_[id] = std::move(info);
     }
 
+    /* compact model: stop vertices are stop indexes, every stop of the route gets its own ride vertex */
+    template <typename It>
+    void AddRideToGraph(It begin, It end, const Bus& bus){
+
+        graph::VertexId prev_ride = 0;
+        size_t prev_stop = 0;
+
+        for(auto stop = begin; stop != end; std::advance(stop, 1)){
+
+            const size_t stop_index = (*stop)->GetIndex();
+            const graph::VertexId ride = next_vertex_++;
+
+            EdgeInfo edge_info;
+            edge_info.bus_id = bus.GetIndex();
+            edge_info.from = stop_index;
+            edge_info.to = stop_index;
+            edge_info.distance_m = 0;
+            edge_info.span_count = 0;
+
+            if(stop != begin){
+                edge_info.type = EdgeType::RIDE;
+                edge_info.from = prev_stop;
+                edge_info.distance_m = catalogue_.GetDistance(*std::prev(stop), *stop);
+                edge_info.span_count = 1;
+                StoreEdgeInfo(graph_->AddEdge({prev_ride, ride, edge_info.distance_m}), edge_info);
+
+                edge_info.type = EdgeType::ALIGHT;
+                edge_info.from = stop_index;
+                edge_info.distance_m = 0;
+                edge_info.span_count = 0;
+                StoreEdgeInfo(graph_->AddEdge({ride, stop_index, 0}), edge_info);
+            }
+
+            if(std::next(stop) != end){
+                edge_info.type = EdgeType::BOARD;
+                StoreEdgeInfo(graph_->AddEdge({stop_index, ride, bus_wait_distance_}), edge_info);
+            }
+
+            prev_ride = ride;
+            prev_stop = stop_index;
+        }
+    }
+
     template <typename It>
     void AddStopsToGraph(It begin, It end, std::string_view bus_name){
         for(auto stop = begin; stop != end; std::advance(stop, 1)){
@@ -119,13 +200,19 @@ private:
 
     const TransportCatalogue& catalogue_;
     std::unique_ptr<graph::DirectedWeightedGraph<Weight>> graph_;
-    std::unique_ptr<graph::Router<Weight>> router_;
+    std::unique_ptr<graph::RoutingEngine<Weight>> router_;
     routing_settings_t settings_;
     std::vector<EdgeInfo> edge_infos_;
 
     static constexpr double distanceTimeMulti = 1000.0/60.0; //(meters in km)/(minutes in h)
 
     size_t bus_wait_distance_;
+
+    // built on the first RouteMatrix if the engine has no precomputed weights
+    mutable std::once_flag many_to_many_router_flag_;
+    mutable std::unique_ptr<graph::ManyToManyRouter<Weight>> many_to_many_router_;
+
+    graph::VertexId next_vertex_ = 0;
 };
 
 } // namespace TC
\ No newline at end of file